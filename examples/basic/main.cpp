@@ -64,8 +64,8 @@ void setup() {
     Serial.println(WiFi.localIP());
     
     // Initialize dashboard with PROGMEM HTML
-    // Parameters: server, htmlData, htmlSize, enableOTA, enableConsole
-    dashboard.begin(&server, DASHBOARD_HTML_DATA, DASHBOARD_HTML_SIZE, true, true);
+    // Parameters: server, files of the web UI (dashboard_html.h), enableOTA, enableConsole
+    dashboard.begin(&server, DASHBOARD_ASSETS, DASHBOARD_ASSET_COUNT, true, true);
     
     // Set dashboard title and subtitle (displayed in browser)
     dashboard.setTitle("My ESP32 Device", "Home Automation Hub");
@@ -424,7 +424,7 @@ void loop() {
         // Cycle through different log levels
         switch (logCounter % 4) {
             case 0:
-                dashboard.logDebug("Sensor data collected: T=" + String(temperature, 1) + "C");
+                dashboard.logf(LogLevel::DEBUG, "Sensor data collected: T=%.1fC", temperature);
                 break;
             case 1:
                 dashboard.logInfo("System heartbeat #" + String(logCounter));
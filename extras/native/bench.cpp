@@ -0,0 +1,281 @@
+/**
+ * ESP Dashboard - Host Micro-Benchmarks
+ *
+ * Times the library's hot paths on the host build and prints one JSON object
+ * per benchmark (JSON lines) on stdout:
+ *
+ *   {"name":"sendCardsToClient/50","iterations":2048,"ns_per_op":51234.5,
+ *    "alloc_bytes_per_op":18342.0,"allocs_per_op":61.0,"wire_bytes_per_op":9873.0}
+ *
+ *   pio run -e native-bench -t exec > bench.jsonl
+ *   python scripts/bench_compare.py baseline.jsonl bench.jsonl
+ *
+ * Allocations are counted at malloc (glibc) or operator new (elsewhere), so
+ * they include ArduinoJson's pool. wire_bytes_per_op is what the dashboard
+ * queued for the WebSocket client. Host timings do not predict ESP32 timings;
+ * compare runs on the same machine only.
+ */
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <ESPDashboardPlus.h>
+#include <dashboard_html.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+// ---------------------------------------------------------------------------
+// Allocation counting
+// ---------------------------------------------------------------------------
+
+static std::atomic<uint64_t> allocCount{0};
+static std::atomic<uint64_t> allocBytes{0};
+
+static inline void countAlloc(size_t size) {
+    allocCount.fetch_add(1, std::memory_order_relaxed);
+    allocBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+#if defined(__GLIBC__)
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) {
+    countAlloc(size);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+    countAlloc(n * size);
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    countAlloc(size);
+    return __libc_realloc(ptr, size);
+}
+}
+#else
+void* operator new(size_t size) {
+    countAlloc(size);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+#endif
+
+// ---------------------------------------------------------------------------
+// Harness
+// ---------------------------------------------------------------------------
+
+static const uint64_t MIN_RUN_NS = 200 * 1000 * 1000;  // Per benchmark, after warm-up
+
+static uint64_t nowNs() {
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Run op in doubling batches until MIN_RUN_NS have passed, then report the last batch.
+// op returns the bytes it put on the wire (0 if not applicable).
+template <typename Op>
+static void bench(const char* name, Op op) {
+    for (int i = 0; i < 16; i++) op();  // Warm-up: fill pools, reach steady state
+
+    uint64_t iterations = 1;
+    for (;;) {
+        uint64_t wire = 0;
+        uint64_t allocs = allocCount.load();
+        uint64_t bytes = allocBytes.load();
+        uint64_t start = nowNs();
+        for (uint64_t i = 0; i < iterations; i++) wire += op();
+        uint64_t elapsed = nowNs() - start;
+        allocs = allocCount.load() - allocs;
+        bytes = allocBytes.load() - bytes;
+
+        if (elapsed >= MIN_RUN_NS || iterations >= (1ull << 30)) {
+            double n = (double)iterations;
+            printf("{\"name\":\"%s\",\"iterations\":%llu,\"ns_per_op\":%.1f,"
+                   "\"alloc_bytes_per_op\":%.1f,\"allocs_per_op\":%.2f,\"wire_bytes_per_op\":%.1f}\n",
+                   name, (unsigned long long)iterations, elapsed / n, bytes / n, allocs / n, wire / n);
+            fflush(stdout);
+            return;
+        }
+        iterations *= 2;
+    }
+}
+
+// Bytes queued for the client since the last call; empties the outbox
+static size_t takeOutbox(AsyncWebSocketClient* client) {
+    size_t total = 0;
+    for (const auto& msg : client->outbox) total += msg.data.size();
+    client->outbox.clear();
+    return total;
+}
+
+// One dashboard with a connected loopback client
+struct Fixture {
+    AsyncWebServer server{80};
+    ESPDashboardPlus dashboard{"Benchmark"};
+    AsyncWebSocket* ws = nullptr;
+    AsyncWebSocketClient* client = nullptr;
+
+    explicit Fixture(bool msgpack = false) {
+        dashboard.begin(&server, DASHBOARD_ASSETS, DASHBOARD_ASSET_COUNT);
+        ws = server.sockets().front();
+        client = ws->injectConnect();
+        if (msgpack) send("{\"type\":\"init\",\"protocol\":\"msgpack\"}");
+        takeOutbox(client);
+    }
+
+    size_t send(const String& message) {
+        ws->injectText(client, message);
+        dashboard.loop();
+        return takeOutbox(client);
+    }
+};
+
+// A representative mix of card types, cycling through the common ones
+static void addCards(ESPDashboardPlus& dashboard, int count) {
+    for (int i = 0; i < count; i++) {
+        String id = "card-" + String(i);
+        switch (i % 6) {
+            case 0: dashboard.addStatCard(id, "Stat " + String(i), "23.5", "C"); break;
+            case 1: dashboard.addGaugeCard(id, "Gauge " + String(i), 0, 100, "%")->setValue(42); break;
+            case 2: dashboard.addToggleCard(id, "Toggle " + String(i), "Relay", i % 4 == 0); break;
+            case 3: dashboard.addSliderCard(id, "Slider " + String(i), 0, 255, 1, "")->setValue(128); break;
+            case 4: dashboard.addStatusCard(id, "Status " + String(i), StatusIcon::CHECK); break;
+            case 5: {
+                ChartCard* chart = dashboard.addChartCard(id, "Chart " + String(i));
+                for (int p = 0; p < 20; p++) chart->addDataPoint(p * 0.5f);
+                break;
+            }
+        }
+    }
+}
+
+static String base64Encode(const uint8_t* data, size_t len) {
+    static const char* chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    String out;
+    out.reserve((len + 2) / 3 * 4);
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = (uint32_t)data[i] << 16;
+        if (i + 1 < len) v |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < len) v |= data[i + 2];
+        out += chars[(v >> 18) & 63];
+        out += chars[(v >> 12) & 63];
+        out += i + 1 < len ? chars[(v >> 6) & 63] : '=';
+        out += i + 2 < len ? chars[v & 63] : '=';
+    }
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// Benchmarks
+// ---------------------------------------------------------------------------
+
+// Full init snapshot to one client, requested by an init frame as the page does
+static void benchSendCards(int cards, bool msgpack = false) {
+    Fixture f(msgpack);
+    addCards(f.dashboard, cards);
+    char name[64];
+    snprintf(name, sizeof(name), "sendCardsToClient/%d%s", cards, msgpack ? ",msgpack" : "");
+    const char* init = msgpack ? "{\"type\":\"init\",\"protocol\":\"msgpack\"}" : "{\"type\":\"init\"}";
+    bench(name, [&]() { return f.send(init); });
+}
+
+// One data point appended and the whole series set broadcast
+static void benchChartUpdate(int maxPoints, int seriesCount, bool msgpack = false) {
+    Fixture f(msgpack);
+    ChartCard* chart = f.dashboard.addChartCard("chart", "Chart", ChartType::LINE, maxPoints);
+    for (int s = 0; s < seriesCount; s++) chart->addSeries("Series " + String(s));
+    for (int p = 0; p < maxPoints; p++) {
+        for (int s = 0; s < seriesCount; s++) chart->addDataPoint(s, p * 0.25f);
+    }
+    int next = 0;
+    char name[64];
+    snprintf(name, sizeof(name), "updateChartCard/points=%d,series=%d%s", maxPoints, seriesCount,
+             msgpack ? ",msgpack" : "");
+    bench(name, [&]() {
+        f.dashboard.updateChartCard("chart", next, 12.5f + next);
+        next = (next + 1) % seriesCount;
+        return takeOutbox(f.client);
+    });
+}
+
+static void benchInboundFrames() {
+    Fixture f;
+    ToggleCard* toggle = f.dashboard.addToggleCard("led", "LED", "Status LED", false);
+    bool state = false;
+    toggle->onChange = [&](bool value) { state = value; };
+    f.dashboard.onCommand([](const String&) {});
+
+    String on = "{\"type\":\"action\",\"cardId\":\"led\",\"action\":\"change\",\"data\":{\"value\":true}}";
+    String off = "{\"type\":\"action\",\"cardId\":\"led\",\"action\":\"change\",\"data\":{\"value\":false}}";
+    bench("handleWebSocketMessage/action", [&]() { return f.send(state ? off : on); });
+
+    bench("handleWebSocketMessage/command", [&]() { return f.send("{\"type\":\"command\",\"command\":\"status\"}"); });
+
+    // 1 KB firmware chunks (as sent by the OTA tab) into an upload that never completes
+    uint8_t chunk[1024];
+    for (size_t i = 0; i < sizeof(chunk); i++) chunk[i] = (uint8_t)(i * 7);
+    String frame = "{\"type\":\"ota_chunk\",\"data\":\"" + base64Encode(chunk, sizeof(chunk)) + "\"}";
+    f.send("{\"type\":\"ota_start\",\"name\":\"firmware.bin\",\"size\":1073741824}");
+    bench("handleWebSocketMessage/ota_chunk", [&]() { return f.send(frame); });
+}
+
+static void benchConsole() {
+    ConsoleCard console("console", "Console", 100);
+    static const char message[] = "sensor 3: temperature 23.51 C, humidity 45.2 %, pressure 1013.2 hPa";
+    for (int i = 0; i < 200; i++) console.addLog(LogLevel::INFO, message, sizeof(message) - 1);
+    bench("ConsoleCard::addLog/full", [&]() {
+        console.addLog(LogLevel::INFO, message, sizeof(message) - 1);
+        return (size_t)0;
+    });
+}
+
+// Written by benchBase64() so the decode cannot be optimized away
+volatile uint8_t base64Sink;
+
+static void benchBase64() {
+    uint8_t chunk[1024];
+    for (size_t i = 0; i < sizeof(chunk); i++) chunk[i] = (uint8_t)(i * 13);
+    String encoded = base64Encode(chunk, sizeof(chunk));
+    uint8_t decoded[1024];
+    bench("base64Decode/1024", [&]() {
+        size_t len = dashboardBase64DecodedLength(encoded.c_str(), encoded.length());
+        dashboardBase64Decode(encoded.c_str(), encoded.length(), decoded);
+        base64Sink = decoded[len - 1];
+        return (size_t)0;
+    });
+}
+
+int main() {
+    Serial.quiet = true;
+
+    benchSendCards(10);
+    benchSendCards(50);
+    benchSendCards(200);
+
+    benchChartUpdate(20, 1);
+    benchChartUpdate(100, 1);
+    benchChartUpdate(20, 4);
+    benchChartUpdate(100, 4);
+
+    // The same with a client that negotiated MessagePack
+    benchSendCards(50, true);
+    benchChartUpdate(100, 1, true);
+    benchChartUpdate(100, 4, true);
+
+    benchInboundFrames();
+    benchConsole();
+    benchBase64();
+    return 0;
+}
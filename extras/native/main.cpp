@@ -0,0 +1,354 @@
+/**
+ * ESP Dashboard - Host Smoke Run
+ *
+ * Runs the real ESPDashboardPlus.h on Linux against the in-memory shims in
+ * extras/native/shims: one loopback client connects, requests the init
+ * snapshot, toggles a card and receives the resulting updates, first as JSON
+ * and then as MessagePack. Focused checks follow for the lock-free rings, the
+ * console ring, log filtering and batching, and the Prometheus output.
+ *
+ *   pio run -e native -t exec
+ *
+ * Exits non-zero if the dashboard does not answer as expected.
+ */
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <ESPDashboardPlus.h>
+#include <dashboard_html.h>
+#include <thread>
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+    printf("[native] %-40s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok) failures++;
+}
+
+// Value of a response header, empty if absent
+static String responseHeader(AsyncWebServerRequest& request, const char* name) {
+    if (!request.response()) return String();
+    for (const auto& h : request.response()->headers) {
+        if (h.name() == name) return h.value();
+    }
+    return String();
+}
+
+// Drop everything a client has received and report whether a message containing `needle` was among it
+static bool drain(AsyncWebSocketClient* client, const char* needle, size_t* bytes = nullptr) {
+    bool found = false;
+    size_t total = 0;
+    for (const auto& msg : client->outbox) {
+        total += msg.data.size();
+        if (msg.data.find(needle) != std::string::npos) found = true;
+    }
+    client->outbox.clear();
+    if (bytes) *bytes = total;
+    return found;
+}
+
+// Body of a GET request, empty if it was not answered with 200
+static std::string get(AsyncWebServer& server, const char* url) {
+    AsyncWebServerRequest request(HTTP_GET, url);
+    server.handle(request);
+    if (!request.response() || request.response()->code != 200) return std::string();
+    return request.response()->body();
+}
+
+// True if text is well-formed UTF-8; browsers drop the socket on anything else
+static bool validUtf8(const std::string& text) {
+    size_t i = 0;
+    while (i < text.size()) {
+        uint8_t c = (uint8_t)text[i];
+        size_t n = c < 0x80 ? 0 : (c & 0xE0) == 0xC0 ? 1 : (c & 0xF0) == 0xE0 ? 2 : (c & 0xF8) == 0xF0 ? 3 : 4;
+        if (n == 4 || i + n >= text.size()) return false;
+        for (size_t k = 1; k <= n; k++) {
+            if (((uint8_t)text[i + k] & 0xC0) != 0x80) return false;
+        }
+        i += n + 1;
+    }
+    return true;
+}
+
+static size_t occurrences(const std::string& text, const char* needle) {
+    size_t n = 0;
+    for (size_t pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) n++;
+    return n;
+}
+
+// Deferred action ring: FIFO order, full at N, and slots reused after wrapping
+static void checkSpscRing() {
+    SpscRing<int, 4> ring;
+    int in = 0;
+    while (int* slot = ring.reserve()) {
+        *slot = ++in;
+        ring.commit();
+    }
+    bool ok = in == 4 && ring.size() == 4;
+    for (int i = 1; i <= 2; i++) {
+        ok = ok && ring.front() && *ring.front() == i;
+        ring.pop();
+    }
+    for (int i = 5; i <= 6; i++) {
+        int* slot = ring.reserve();
+        ok = ok && slot;
+        if (slot) *slot = i;
+        ring.commit();
+    }
+    for (int i = 3; i <= 6; i++) {
+        ok = ok && ring.front() && *ring.front() == i;
+        ring.pop();
+    }
+    check(ok && !ring.front(), "SpscRing order and wraparound");
+}
+
+// Published update queue: bounded, and no item lost or reordered per producer under contention
+static void checkMpscQueue() {
+    MpscQueue<int, 4> small;
+    bool ok = true;
+    for (int i = 1; i <= 4; i++) ok = ok && small.push(i);
+    ok = ok && !small.push(5);
+    int v = 0;
+    for (int i = 1; i <= 4; i++) ok = ok && small.pop(v) && v == i;
+    check(ok && !small.pop(v), "MpscQueue order and capacity");
+
+    static const int PRODUCERS = 4;
+    static const int ITEMS = 20000;
+    static MpscQueue<int, 64> queue;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; p++) {
+        producers.emplace_back([p]() {
+            for (int i = 0; i < ITEMS; i++) {
+                while (!queue.push(p * ITEMS + i)) std::this_thread::yield();
+            }
+        });
+    }
+    int next[PRODUCERS] = {0};
+    int received = 0;
+    bool ordered = true;
+    while (received < PRODUCERS * ITEMS) {
+        if (!queue.pop(v)) {
+            std::this_thread::yield();
+            continue;
+        }
+        int p = v / ITEMS;
+        ordered = ordered && p >= 0 && p < PRODUCERS && v % ITEMS == next[p];
+        if (p >= 0 && p < PRODUCERS) next[p]++;
+        received++;
+    }
+    for (std::thread& t : producers) t.join();
+    check(ordered && !queue.pop(v), "MpscQueue under 4 producers");
+}
+
+// Log capture ring: records never straddle the end, padding is skipped, and an
+// uncommitted record holds back the ones behind it
+static void checkMpscByteRing() {
+    MpscByteRing<64> ring;
+    const uint8_t* data;
+    size_t len;
+    bool ok = ring.reserve(40) == nullptr;  // More than half the ring
+    uint8_t* a = ring.reserve(20);
+    memset(a, 'a', 20);
+    ring.commit(a, 20);
+    uint8_t* b = ring.reserve(20);
+    memset(b, 'b', 20);
+    ring.commit(b, 20);
+    ok = ok && ring.reserve(20) == nullptr;  // 24 + 24 + 24 > 64
+    ok = ok && ring.front(data, len) && len == 20 && data[0] == 'a';
+    ring.pop();
+    uint8_t* c = ring.reserve(20);  // Does not fit before the end: wraps to offset 0
+    ok = ok && c && c < b;
+    ok = ok && ring.front(data, len) && data[0] == 'b';
+    ring.pop();
+    ok = ok && !ring.front(data, len);  // c is reserved but not committed yet
+    if (c) {
+        memset(c, 'c', 20);
+        ring.commit(c, 20);
+    }
+    ok = ok && ring.front(data, len) && len == 20 && data[0] == 'c' && data[19] == 'c';
+    ring.pop();
+    check(ok && !ring.front(data, len), "MpscByteRing wraparound and commit order");
+}
+
+// Console card ring: eviction by entry count and by bytes, messages intact across the end
+static void checkConsoleRing() {
+    ConsoleCard console("console", "Console", 3, 64);
+    console.addLog(LogLevel::INFO, "one");
+    console.addLog(LogLevel::INFO, "two");
+    console.addLog(LogLevel::INFO, "three");
+    console.addLog(LogLevel::INFO, "four");
+    std::string joined;
+    console.forEachLog([&](uint32_t, LogLevel, const char* message, size_t) {
+        joined += message;
+        joined += ',';
+    });
+    check(console.logCount() == 3 && joined == "two,three,four,", "console ring evicts by entry count");
+
+    // 7-byte headers: 10 + 12 + 11 bytes in use, a 47-byte entry pushes out two
+    std::string wide(40, 'w');
+    console.addLog(LogLevel::WARNING, wide.c_str(), wide.size());
+    joined.clear();
+    console.forEachLog([&](uint32_t, LogLevel, const char* message, size_t) {
+        joined += message;
+        joined += ',';
+    });
+    check(console.logCount() == 2 && joined == "four," + wide + ",", "console ring evicts by bytes and wraps");
+
+    // A cut never splits a UTF-8 character
+    ConsoleCard large("large");
+    std::string message(DASHBOARD_CONSOLE_MAX_MESSAGE - 1, 'x');
+    message += "\xc3\xa9";
+    large.addLog(LogLevel::INFO, message.c_str(), message.size());
+    size_t stored = 0;
+    large.forEachLog([&](uint32_t, LogLevel, const char*, size_t len) { stored = len; });
+    check(stored == DASHBOARD_CONSOLE_MAX_MESSAGE - 1, "console cut on a character boundary");
+}
+
+int main() {
+    checkSpscRing();
+    checkMpscQueue();
+    checkMpscByteRing();
+    checkConsoleRing();
+
+    AsyncWebServer server(80);
+    ESPDashboardPlus dashboard("Native Dashboard");
+    dashboard.begin(&server, DASHBOARD_ASSETS, DASHBOARD_ASSET_COUNT);
+
+    dashboard.addStatCard("temp", "Temperature", "23.5", "C");
+    dashboard.addGaugeCard("cpu", "CPU", 0, 100, "%");
+    ToggleCard* led = dashboard.addToggleCard("led", "LED", "Status LED", false);
+
+    bool toggled = false;
+    led->onChange = [&](bool value) { toggled = value; };
+
+    // Serve the page
+    AsyncWebServerRequest request(HTTP_GET, "/");
+    server.handle(request);
+    check(request.response() && request.response()->code == 200, "GET / answered");
+    
+    // Reload with the cached copy's ETag
+    String etag = responseHeader(request, "ETag");
+    AsyncWebServerRequest reload(HTTP_GET, "/");
+    reload.addHeader("If-None-Match", etag);
+    server.handle(reload);
+    check(etag.length() > 0 && reload.response() && reload.response()->code == 304, "GET / revalidated with 304");
+
+    // A browser that offers Brotli gets it when the header was built with it
+    AsyncWebServerRequest secure(HTTP_GET, "/");
+    secure.addHeader("Accept-Encoding", "gzip, deflate, br");
+    server.handle(secure);
+#ifdef DASHBOARD_HTML_BR_SIZE
+    const char* expected = "br";
+#else
+    const char* expected = "gzip";
+#endif
+    check(responseHeader(secure, "Content-Encoding") == expected, "GET / encoding negotiated");
+
+    // Every file of the UI is served (shell and bundles for a split build)
+    size_t served = 0;
+    for (size_t i = 0; i < DASHBOARD_ASSET_COUNT; i++) {
+        AsyncWebServerRequest asset(HTTP_GET, DASHBOARD_ASSETS[i].path);
+        if (server.handle(asset) && asset.response() && asset.response()->code == 200) served++;
+    }
+    check(served == DASHBOARD_ASSET_COUNT, "UI assets served");
+
+    // Connect one client and request the snapshot
+    AsyncWebSocket* ws = server.sockets().front();
+    AsyncWebSocketClient* client = ws->injectConnect();
+    ws->injectText(client, "{\"type\":\"init\"}");
+    dashboard.loop();
+    size_t initBytes = 0;
+    check(drain(client, "\"type\":\"init\"", &initBytes), "init snapshot sent");
+    printf("[native] init snapshot: %zu bytes\n", initBytes);
+
+    // Toggle from the page; the callback runs and the new state is broadcast
+    ws->injectText(client, "{\"type\":\"action\",\"cardId\":\"led\",\"action\":\"change\",\"data\":{\"value\":true}}");
+    dashboard.loop();
+    check(toggled, "toggle callback ran");
+
+    // Updates from the application reach the client
+    dashboard.updateGaugeCard("cpu", 42);
+    dashboard.loop();
+    check(drain(client, "\"cpu\""), "gauge update sent");
+
+    // A page that asks for MessagePack gets binary frames from then on
+    ws->injectText(client, "{\"type\":\"init\",\"protocol\":\"msgpack\"}");
+    dashboard.loop();
+    bool binaryInit = !client->outbox.empty() && client->outbox.back().binary;
+    size_t packedBytes = 0;
+    drain(client, "", &packedBytes);
+    check(binaryInit, "init snapshot sent as MessagePack");
+    printf("[native] init snapshot (MessagePack): %zu bytes\n", packedBytes);
+    dashboard.updateGaugeCard("cpu", 43);
+    dashboard.loop();
+    check(!client->outbox.empty() && client->outbox.back().binary, "update sent as MessagePack");
+    client->outbox.clear();
+
+    ws->injectDisconnect(client);
+    dashboard.loop();
+    check(ws->count() == 0, "client disconnected");
+
+    // Console subscription: warnings and up, tag "wifi" only; lines go out as one batch
+    dashboard.setLogFlushInterval(60000);
+    AsyncWebSocketClient* console = ws->injectConnect();
+    ws->injectText(console, "{\"type\":\"log_subscribe\",\"level\":\"warning\",\"tags\":[\"wifi\"]}");
+    dashboard.loop();
+    console->outbox.clear();
+    dashboard.log(LogLevel::INFO, "wifi", "too-low");
+    dashboard.log(LogLevel::WARNING, "wifi", "first-kept");
+    dashboard.log(LogLevel::ERROR, "http", "other-tag");
+    dashboard.log(LogLevel::ERROR, "wifi", "second-kept");
+    dashboard.loop();
+    check(console->outbox.empty(), "log lines held until the batch is due");
+    dashboard.flushLogs();
+    std::string batch = console->outbox.size() == 1 ? console->outbox.front().data : std::string();
+    console->outbox.clear();
+    check(batch.find("first-kept") != std::string::npos && batch.find("second-kept") != std::string::npos,
+          "log lines batched into one frame");
+    check(!batch.empty() && batch.find("too-low") == std::string::npos && batch.find("other-tag") == std::string::npos,
+          "log lines filtered by level and tag");
+    ws->injectDisconnect(console);
+    dashboard.loop();
+
+    // A formatted line cut to DASHBOARD_LOG_LINE_SIZE drops a partial character instead of sending it
+    AsyncWebSocketClient* viewer = ws->injectConnect();
+    dashboard.loop();
+    viewer->outbox.clear();
+    std::string filler(DASHBOARD_LOG_LINE_SIZE - 2, 'y');
+    dashboard.logf(LogLevel::INFO, "%s\xc3\xa9", filler.c_str());
+    dashboard.flushLogs();
+    batch = viewer->outbox.size() == 1 ? viewer->outbox.front().data : std::string();
+    check(batch.find(filler) != std::string::npos && validUtf8(batch), "long formatted line cut on a character");
+    ws->injectDisconnect(viewer);
+    dashboard.loop();
+
+    // Prometheus: library metrics on request, card values with escaped and colliding names
+    check(get(server, "/metrics").find("dashboard_messages_sent_total") == std::string::npos,
+          "library metrics not served by default");
+    dashboard.enableMetricsEndpoints();
+    dashboard.addGaugeCard("temp-1", "Inside")->setValue(21.5f);
+    dashboard.addGaugeCard("temp_1", "Outside")->setValue(3.25f);
+    dashboard.addGroup("env\"1", "Environment", {"cpu"});
+    dashboard.enableCardMetrics();
+    AsyncWebSocketClient* scraper = ws->injectConnect();
+    std::string metrics = get(server, "/metrics");
+    ws->injectDisconnect(scraper);
+    dashboard.loop();
+    check(metrics.find("\ndashboard_clients 1\n") != std::string::npos &&
+          metrics.find("dashboard_client_queue_length{client=\"") != std::string::npos,
+          "connected clients counted");
+    check(metrics.find("# TYPE dashboard_messages_sent_total counter") != std::string::npos,
+          "library metrics served");
+    check(metrics.find("\ndashboard_card_temp 23.5\n") != std::string::npos &&
+          metrics.find("\ndashboard_card_cpu{group=\"env\\\"1\"} 43\n") != std::string::npos,
+          "card metrics with escaped labels");
+    check(occurrences(metrics, "# TYPE dashboard_card_temp_1 gauge") == 1 &&
+          metrics.find("dashboard_card_temp_1{card=\"temp-1\"} 21.5\n") != std::string::npos &&
+          metrics.find("dashboard_card_temp_1{card=\"temp_1\"} 3.25\n") != std::string::npos,
+          "colliding card metric names labelled");
+    AsyncWebServerRequest json(HTTP_GET, "/metrics.json");
+    check(server.handle(json) && json.response() && json.response()->code == 200, "metrics JSON answered");
+
+    printf("[native] %s\n", failures ? "FAILED" : "all checks passed");
+    return failures ? 1 : 0;
+}
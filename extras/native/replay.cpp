@@ -0,0 +1,381 @@
+/**
+ * ESP Dashboard - Traffic Replayer
+ *
+ * Feeds a log written by ESPDashboardPlus::startRecording() into the host
+ * build: the recorded cards are recreated, clients connect and disconnect,
+ * inbound messages arrive and update calls are made in the recorded order,
+ * either at the recorded pace or as fast as possible.
+ *
+ *   pio run -e native-replay
+ *   .pio/build/native-replay/program traffic.edrc            # 1x
+ *   .pio/build/native-replay/program traffic.edrc --fast     # no waiting
+ *
+ * loop() runs whenever recorded time advances by a millisecond, in both modes,
+ * so both make the same calls in the same order; only timers inside the
+ * library (heartbeat, log batching) follow the host clock. The summary is one
+ * JSON line; run it against two library versions to compare them on
+ * identical traffic.
+ */
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <ESPDashboardPlus.h>
+#include <dashboard_html.h>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+static uint64_t nowNs() {
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// ---------------------------------------------------------------------------
+// Log reader
+// ---------------------------------------------------------------------------
+
+struct LogReader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool bad = false;
+
+    bool more() const { return !bad && p < end; }
+
+    uint8_t u8() {
+        if (p >= end) { bad = true; return 0; }
+        return *p++;
+    }
+    uint32_t varint() {
+        uint32_t v = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            uint8_t b = u8();
+            v |= (uint32_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        bad = true;
+        return 0;
+    }
+    int32_t i32() {
+        uint32_t v = 0;
+        for (int i = 0; i < 4; i++) v |= (uint32_t)u8() << (i * 8);
+        return (int32_t)v;
+    }
+    float f32() {
+        int32_t bits = i32();
+        float v;
+        memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+    std::string bytes(size_t len) {
+        if ((size_t)(end - p) < len) { bad = true; return std::string(); }
+        std::string s((const char*)p, len);
+        p += len;
+        return s;
+    }
+    String str() { return String(bytes(varint()).c_str()); }
+};
+
+// ---------------------------------------------------------------------------
+// Replay
+// ---------------------------------------------------------------------------
+
+struct Replay {
+    AsyncWebServer server{80};
+    ESPDashboardPlus dashboard{"Replay"};
+    AsyncWebSocket* ws = nullptr;
+    std::map<uint32_t, uint32_t> clients;  // Recorded client id -> host client id
+    uint8_t version = 2;                    // Log format version from the header
+
+    uint32_t counts[8] = {0};
+    uint32_t skipped = 0;        // Records for cards that were not recreated
+    uint64_t libraryNs = 0;      // Time spent inside library calls
+    uint64_t wireBytes = 0;
+    uint64_t wireMessages = 0;
+    uint64_t loops = 0;
+
+    Replay() {
+        dashboard.begin(&server, DASHBOARD_ASSETS, DASHBOARD_ASSET_COUNT);
+        ws = server.sockets().front();
+    }
+
+    // Recreate a card from its init JSON with the same id, type and layout.
+    // maxPoints is 0 in version 1 logs, which do not record it.
+    void addCard(const std::string& json, uint32_t maxPoints, ChartType chartType) {
+        JsonDocument doc;
+        if (deserializeJson(doc, json)) return;
+        String id = doc["id"] | "";
+        const char* type = doc["type"] | "";
+        JsonObject config = doc["config"];
+        String title = config["title"] | "";
+        DashboardCard* card = nullptr;
+
+        switch (dashboardHash(type)) {
+            case dashboardHash("stat"):
+                card = dashboard.addStatCard(id, title, config["value"] | "", config["unit"] | "");
+                break;
+            case dashboardHash("status"):
+                card = dashboard.addStatusCard(id, title);
+                break;
+            case dashboardHash("chart"): {
+                JsonArray series = config["series"];
+                if (maxPoints == 0) {
+                    size_t points = series.size() > 0 ? series[0]["data"].size() : config["data"].size();
+                    maxPoints = points > 20 ? points : 20;
+                }
+                ChartCard* chart = dashboard.addChartCard(id, title, chartType, (int)maxPoints);
+                for (JsonObject s : series) chart->addSeries(s["name"] | "", s["color"] | "primary");
+                card = chart;
+                break;
+            }
+            case dashboardHash("button"):
+                card = dashboard.addButtonCard(id, title, config["label"] | "", []() {});
+                break;
+            case dashboardHash("action"):
+                card = dashboard.addActionButton(id, title, config["label"] | "", config["confirmTitle"] | "",
+                                                 config["confirmMessage"] | "", []() {});
+                break;
+            case dashboardHash("link"):
+                card = dashboard.addLinkCard(id, title, config["label"] | "", config["url"] | "");
+                break;
+            case dashboardHash("timezone"):
+                card = dashboard.addTimezoneCard(id, title, config["label"] | "");
+                break;
+            case dashboardHash("date"):
+                card = dashboard.addDateCard(id, title, config["includeTime"] | false);
+                break;
+            case dashboardHash("time"):
+                card = dashboard.addTimeCard(id, title, config["includeSeconds"] | false);
+                break;
+            case dashboardHash("location"):
+                card = dashboard.addLocationCard(id, title, config["label"] | "");
+                break;
+            case dashboardHash("input"):
+                card = dashboard.addInputCard(id, title, config["placeholder"] | "");
+                break;
+            case dashboardHash("color"):
+                card = dashboard.addColorPickerCard(id, title, config["value"] | "#00D4AA");
+                break;
+            case dashboardHash("dropdown"): {
+                DropdownCardImpl* dropdown = dashboard.addDropdownCard(id, title, config["placeholder"] | "");
+                for (JsonObject o : config["options"].as<JsonArray>()) dropdown->addOption(o["value"] | "", o["label"] | "");
+                card = dropdown;
+                break;
+            }
+            case dashboardHash("toggle"):
+                card = dashboard.addToggleCard(id, title, config["label"] | "", config["value"] | false);
+                break;
+            case dashboardHash("slider"):
+                card = dashboard.addSliderCard(id, title, config["min"] | 0, config["max"] | 100, config["step"] | 1,
+                                               config["unit"] | "");
+                break;
+            case dashboardHash("gauge"):
+                card = dashboard.addGaugeCard(id, title, config["min"] | 0.0f, config["max"] | 100.0f, config["unit"] | "");
+                break;
+            default:
+                printf("[replay] card '%s' of type '%s' not recreated\n", id.c_str(), type);
+                return;
+        }
+        card->setWeight(doc["weight"] | 0);
+    }
+
+    AsyncWebSocketClient* client(uint32_t recordedId) {
+        auto it = clients.find(recordedId);
+        return it == clients.end() ? nullptr : ws->client(it->second);
+    }
+
+    void update(LogReader& in) {
+        DashboardRecorder::Update what = (DashboardRecorder::Update)in.u8();
+        String id = in.str();
+        if (!dashboard.getCard(id)) skipped++;
+
+        switch (what) {
+            case DashboardRecorder::Update::STAT: dashboard.updateStatCard(id, in.str()); break;
+            case DashboardRecorder::Update::STATUS: {
+                StatusIcon icon = (StatusIcon)in.u8();
+                CardVariant variant = (CardVariant)in.u8();
+                String label = in.str();
+                dashboard.updateStatusCard(id, icon, variant, label, in.str());
+                break;
+            }
+            case DashboardRecorder::Update::CHART: dashboard.updateChartCard(id, in.f32()); break;
+            case DashboardRecorder::Update::CHART_SERIES: {
+                int series = (int)in.varint();
+                dashboard.updateChartCard(id, series, in.f32());
+                break;
+            }
+            case DashboardRecorder::Update::GAUGE: dashboard.updateGaugeCard(id, in.f32()); break;
+            case DashboardRecorder::Update::TOGGLE: dashboard.updateToggleCard(id, in.u8() != 0); break;
+            case DashboardRecorder::Update::SLIDER: dashboard.updateSliderCard(id, in.i32()); break;
+            case DashboardRecorder::Update::COLOR: dashboard.updateColorCard(id, in.str()); break;
+            case DashboardRecorder::Update::DROPDOWN: dashboard.updateDropdownCard(id, in.str()); break;
+            case DashboardRecorder::Update::DATE: dashboard.updateDateCard(id, in.str()); break;
+            case DashboardRecorder::Update::TIME: dashboard.updateTimeCard(id, in.str()); break;
+            case DashboardRecorder::Update::LOCATION: {
+                float latitude = in.f32();
+                dashboard.updateLocationCard(id, latitude, in.f32());
+                break;
+            }
+            case DashboardRecorder::Update::LINK: dashboard.updateLinkCard(id, in.str()); break;
+            default: in.bad = true; break;
+        }
+    }
+
+    void publish(LogReader& in) {
+        uint8_t kind = in.u8();
+        String id = in.str();
+        int8_t arg = (int8_t)in.u8();
+        int32_t bits = in.i32();
+        String text = in.str();
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+
+        DashboardCard* card = dashboard.getCard(id);
+        if (!card) {
+            skipped++;
+            return;
+        }
+        switch ((DashboardUpdateKind)kind) {
+            case DashboardUpdateKind::STAT_TEXT:
+                dashboard.publishUpdate(static_cast<StatCard*>(card), text.c_str());
+                break;
+            case DashboardUpdateKind::STAT_NUMBER:
+                dashboard.publishUpdate(static_cast<StatCard*>(card), f, arg);
+                break;
+            case DashboardUpdateKind::GAUGE:
+                dashboard.publishUpdate(static_cast<GaugeCard*>(card), f);
+                break;
+            case DashboardUpdateKind::CHART:
+                dashboard.publishUpdate(static_cast<ChartCard*>(card), f);
+                break;
+            case DashboardUpdateKind::CHART_SERIES:
+                dashboard.publishUpdate(static_cast<ChartCard*>(card), (int)arg, f);
+                break;
+            case DashboardUpdateKind::TOGGLE:
+                dashboard.publishUpdate(static_cast<ToggleCard*>(card), (bits & 0xFF) != 0);
+                break;
+            case DashboardUpdateKind::SLIDER:
+                dashboard.publishUpdate(static_cast<SliderCard*>(card), (int)bits);
+                break;
+            default:
+                in.bad = true;
+                break;
+        }
+    }
+
+    // Body of one record; false if the log is corrupt
+    bool step(uint8_t kind, LogReader& in) {
+        if (kind < sizeof(counts) / sizeof(counts[0])) counts[kind]++;
+
+        switch (kind) {
+            case DashboardRecorder::CARD: {
+                uint32_t maxPoints = 0;
+                ChartType chartType = ChartType::LINE;
+                if (version >= 2) {
+                    maxPoints = in.varint();
+                    chartType = (ChartType)in.u8();
+                }
+                addCard(in.bytes(in.varint()), maxPoints, chartType);
+                break;
+            }
+            case DashboardRecorder::CONNECT: {
+                uint32_t id = in.varint();
+                clients[id] = ws->injectConnect()->id();
+                break;
+            }
+            case DashboardRecorder::DISCONNECT: {
+                uint32_t id = in.varint();
+                AsyncWebSocketClient* c = client(id);
+                if (c) ws->injectDisconnect(c);
+                clients.erase(id);
+                break;
+            }
+            case DashboardRecorder::FRAME: {
+                AsyncWebSocketClient* c = client(in.varint());
+                std::string message = in.bytes(in.varint());
+                if (c) ws->injectMessage(c, (const uint8_t*)message.data(), message.size(), WS_TEXT);
+                else skipped++;
+                break;
+            }
+            case DashboardRecorder::UPDATE:
+                update(in);
+                break;
+            case DashboardRecorder::PUBLISH:
+                publish(in);
+                break;
+            default:
+                in.bad = true;
+                break;
+        }
+        return !in.bad;
+    }
+
+    void loop() {
+        uint64_t start = nowNs();
+        dashboard.loop();
+        libraryNs += nowNs() - start;
+        loops++;
+        for (auto& kv : clients) {
+            AsyncWebSocketClient* c = ws->client(kv.second);
+            if (!c) continue;
+            for (const auto& msg : c->outbox) wireBytes += msg.data.size();
+            wireMessages += c->outbox.size();
+            c->outbox.clear();
+        }
+    }
+};
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <log> [--fast]\n", argv[0]);
+        return 2;
+    }
+    bool fast = argc > 2 && strcmp(argv[2], "--fast") == 0;
+
+    std::ifstream file(argv[1], std::ios::binary);
+    std::vector<uint8_t> log((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (log.size() < 5 || memcmp(log.data(), "EDRC", 4) != 0 || log[4] < 1 || log[4] > 2) {
+        fprintf(stderr, "[replay] %s is not a version 1 or 2 dashboard recording\n", argv[1]);
+        return 1;
+    }
+    Serial.quiet = true;
+
+    Replay replay;
+    replay.version = log[4];
+    LogReader in{ log.data() + 5, log.data() + log.size() };
+    uint64_t recordedUs = 0;
+    uint64_t lastLoopUs = 0;
+    uint64_t wallStart = nowNs();
+
+    while (in.more()) {
+        uint8_t kind = in.u8();
+        recordedUs += in.varint();
+        if (!fast) {
+            uint64_t due = wallStart + recordedUs * 1000;
+            uint64_t now = nowNs();
+            if (due > now) std::this_thread::sleep_for(std::chrono::nanoseconds(due - now));
+        }
+        // The device's loop() ran in between; once per recorded millisecond
+        while (recordedUs - lastLoopUs >= 1000) {
+            replay.loop();
+            lastLoopUs += 1000;
+            if (recordedUs - lastLoopUs > 1000) lastLoopUs = recordedUs - 1000;  // Skip idle stretches
+        }
+        uint64_t start = nowNs();
+        if (!replay.step(kind, in)) break;
+        replay.libraryNs += nowNs() - start;
+    }
+    replay.loop();
+
+    if (in.bad) fprintf(stderr, "[replay] log truncated or corrupt at byte %zu\n", (size_t)(in.p - log.data()));
+    printf("{\"records\":{\"card\":%u,\"connect\":%u,\"disconnect\":%u,\"frame\":%u,\"update\":%u,\"publish\":%u},"
+           "\"skipped\":%u,\"recorded_ms\":%.1f,\"wall_ms\":%.1f,\"library_ms\":%.3f,\"loops\":%llu,"
+           "\"wire_messages\":%llu,\"wire_bytes\":%llu,\"dropped_updates\":%u}\n",
+           replay.counts[DashboardRecorder::CARD], replay.counts[DashboardRecorder::CONNECT],
+           replay.counts[DashboardRecorder::DISCONNECT], replay.counts[DashboardRecorder::FRAME],
+           replay.counts[DashboardRecorder::UPDATE], replay.counts[DashboardRecorder::PUBLISH], replay.skipped,
+           recordedUs / 1000.0, (nowNs() - wallStart) / 1e6, replay.libraryNs / 1e6,
+           (unsigned long long)replay.loops, (unsigned long long)replay.wireMessages,
+           (unsigned long long)replay.wireBytes, replay.dashboard.getDroppedUpdates());
+    return in.bad ? 1 : 0;
+}
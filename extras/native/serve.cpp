@@ -0,0 +1,420 @@
+/**
+ * ESP Dashboard - Host Server
+ *
+ * Serves a demo dashboard from the host build over real TCP, so that a
+ * browser, scripts/dashboard_load.py or any other WebSocket client can talk
+ * to it like to a device. A small POSIX socket loop bridges HTTP requests
+ * and WebSocket frames to the in-memory shims; everything else is the real
+ * ESPDashboardPlus.h.
+ *
+ *   pio run -e native-serve -t exec            # port 8080, updates every 1000 ms
+ *   .pio/build/native-serve/program 8081 100   # port 8081, updates every 100 ms
+ *   .pio/build/native-serve/program 8080 1000 traffic.edrc
+ *                                              # also record for extras/native/replay.cpp
+ *
+ * Outgoing messages wait in each client's outbox (WS_MAX_QUEUED_MESSAGES)
+ * while the socket is backed up, so slow clients see the same queue-full
+ * behaviour as on a device. Heap figures reported by the library are fixed
+ * on the host.
+ */
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <ESPDashboardPlus.h>
+#include <dashboard_html.h>
+#include <arpa/inet.h>
+#include <csignal>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Bytes written to a socket but not yet accepted by the kernel before the
+// bridge stops draining the client's outbox
+static const size_t SOCKET_BACKLOG = 64 * 1024;
+
+// ---------------------------------------------------------------------------
+// SHA-1 and base64 for the WebSocket handshake (RFC 6455, section 4.2.2)
+// ---------------------------------------------------------------------------
+
+static void sha1(const uint8_t* data, size_t len, uint8_t out[20]) {
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    std::string msg((const char*)data, len);
+    msg += (char)0x80;
+    while (msg.size() % 64 != 56) msg += (char)0;
+    uint64_t bits = (uint64_t)len * 8;
+    for (int i = 7; i >= 0; i--) msg += (char)(bits >> (i * 8));
+
+    auto rol = [](uint32_t v, int n) { return (v << n) | (v >> (32 - n)); };
+    for (size_t chunk = 0; chunk < msg.size(); chunk += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            const uint8_t* p = (const uint8_t*)msg.data() + chunk + i * 4;
+            w[i] = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+        }
+        for (int i = 16; i < 80; i++) w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+            else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+            else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+            uint32_t t = rol(a, 5) + f + e + k + w[i];
+            e = d; d = c; c = rol(b, 30); b = a; a = t;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+    for (int i = 0; i < 5; i++) {
+        for (int j = 0; j < 4; j++) out[i * 4 + j] = (uint8_t)(h[i] >> (24 - j * 8));
+    }
+}
+
+static std::string base64(const uint8_t* data, size_t len) {
+    static const char* chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = (uint32_t)data[i] << 16;
+        if (i + 1 < len) v |= (uint32_t)data[i + 1] << 8;
+        if (i + 2 < len) v |= data[i + 2];
+        out += chars[(v >> 18) & 63];
+        out += chars[(v >> 12) & 63];
+        out += i + 1 < len ? chars[(v >> 6) & 63] : '=';
+        out += i + 2 < len ? chars[v & 63] : '=';
+    }
+    return out;
+}
+
+// ---------------------------------------------------------------------------
+// Connections
+// ---------------------------------------------------------------------------
+
+struct Connection {
+    int fd;
+    std::string in;
+    std::string out;
+    uint32_t clientId = 0;   // Non-zero once upgraded to a WebSocket
+    std::string message;     // Fragments of the WebSocket message being received
+    uint8_t messageOpcode = 0;
+    bool closing = false;    // Close once `out` is flushed
+};
+
+static AsyncWebServer server(80);
+static ESPDashboardPlus dashboard("Host Dashboard");
+static AsyncWebSocket* ws = nullptr;
+static std::list<Connection> connections;
+static volatile sig_atomic_t stopRequested = 0;
+
+// Recording destination on the host (a File on the device)
+class FilePrint : public Print {
+public:
+    explicit FilePrint(FILE* f) : _f(f) {}
+    size_t write(uint8_t c) override { return fputc(c, _f) == EOF ? 0 : 1; }
+    size_t write(const uint8_t* buf, size_t len) override { return fwrite(buf, 1, len, _f); }
+private:
+    FILE* _f;
+};
+
+static std::string header(const std::string& head, const char* name) {
+    std::string lower = head;
+    for (auto& ch : lower) ch = (char)tolower((unsigned char)ch);
+    std::string key = std::string("\r\n") + name + ":";
+    size_t pos = lower.find(key);
+    if (pos == std::string::npos) return std::string();
+    size_t start = head.find_first_not_of(' ', pos + key.size());
+    size_t end = head.find("\r\n", start);
+    return head.substr(start, end - start);
+}
+
+static void appendFrame(std::string& out, uint8_t opcode, const char* data, size_t len) {
+    out += (char)(0x80 | opcode);
+    if (len < 126) {
+        out += (char)len;
+    } else if (len < 65536) {
+        out += (char)126;
+        out += (char)(len >> 8);
+        out += (char)len;
+    } else {
+        out += (char)127;
+        for (int i = 7; i >= 0; i--) out += (char)((uint64_t)len >> (i * 8));
+    }
+    out.append(data, len);
+}
+
+static void handleHttp(Connection& conn) {
+    size_t end = conn.in.find("\r\n\r\n");
+    if (end == std::string::npos) return;
+    std::string head = conn.in.substr(0, end + 2);
+    conn.in.erase(0, end + 4);
+
+    char method[16] = {0};
+    char target[1024] = {0};
+    if (sscanf(head.c_str(), "%15s %1023s", method, target) != 2) {
+        conn.closing = true;
+        return;
+    }
+    std::string path = target;
+    std::string query;
+    size_t q = path.find('?');
+    if (q != std::string::npos) {
+        query = path.substr(q + 1);
+        path.erase(q);
+    }
+
+    // WebSocket upgrade
+    std::string key = header(head, "sec-websocket-key");
+    if (!key.empty() && path == ws->url()) {
+        std::string accept = key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+        uint8_t digest[20];
+        sha1((const uint8_t*)accept.data(), accept.size(), digest);
+        conn.out += "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                    "Sec-WebSocket-Accept: " + base64(digest, sizeof(digest)) + "\r\n\r\n";
+        AsyncWebSocketClient* client = ws->injectConnect();
+        client->unboundedOutbox = false;
+        conn.clientId = client->id();
+        return;
+    }
+
+    AsyncWebServerRequest request(strcmp(method, "POST") == 0 ? HTTP_POST : HTTP_GET, path.c_str());
+    for (const char* name : { "accept-encoding", "if-none-match", "user-agent" }) {
+        std::string value = header(head, name);
+        if (!value.empty()) request.addHeader(name, value.c_str());
+    }
+    while (!query.empty()) {
+        size_t amp = query.find('&');
+        std::string pair = query.substr(0, amp);
+        size_t eq = pair.find('=');
+        request.addParam(pair.substr(0, eq).c_str(), eq == std::string::npos ? "" : pair.substr(eq + 1).c_str());
+        query = amp == std::string::npos ? std::string() : query.substr(amp + 1);
+    }
+    server.handle(request);
+
+    AsyncWebServerResponse* response = request.response();
+    int code = response ? response->code : 404;
+    std::string body = response ? response->body() : std::string("Not found");
+    char status[128];
+    snprintf(status, sizeof(status), "HTTP/1.1 %d %s\r\n", code, code == 200 ? "OK" : code == 304 ? "Not Modified" : "Error");
+    conn.out += status;
+    if (response) {
+        if (response->contentType.length() > 0) conn.out += "Content-Type: " + response->contentType.str() + "\r\n";
+        for (const auto& h : response->headers) conn.out += h.name().str() + ": " + h.value().str() + "\r\n";
+    }
+    conn.out += "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+    conn.out += body;
+    conn.closing = true;
+}
+
+static void handleFrames(Connection& conn) {
+    AsyncWebSocketClient* client = ws->client(conn.clientId);
+    for (;;) {
+        const uint8_t* p = (const uint8_t*)conn.in.data();
+        size_t avail = conn.in.size();
+        if (avail < 2) return;
+        bool fin = p[0] & 0x80;
+        uint8_t opcode = p[0] & 0x0F;
+        bool masked = p[1] & 0x80;
+        uint64_t len = p[1] & 0x7F;
+        size_t pos = 2;
+        if (len == 126) {
+            if (avail < 4) return;
+            len = (uint64_t)p[2] << 8 | p[3];
+            pos = 4;
+        } else if (len == 127) {
+            if (avail < 10) return;
+            len = 0;
+            for (int i = 0; i < 8; i++) len = len << 8 | p[2 + i];
+            pos = 10;
+        }
+        uint8_t mask[4] = {0};
+        if (masked) {
+            if (avail < pos + 4) return;
+            memcpy(mask, p + pos, 4);
+            pos += 4;
+        }
+        if (avail < pos + len) return;
+        std::string payload = conn.in.substr(pos, len);
+        conn.in.erase(0, pos + len);
+        for (size_t i = 0; masked && i < payload.size(); i++) payload[i] ^= mask[i % 4];
+
+        switch (opcode) {
+            case 0x0:  // Continuation
+            case 0x1:  // Text
+            case 0x2:  // Binary
+                if (opcode != 0x0) {
+                    conn.message.clear();
+                    conn.messageOpcode = opcode;
+                }
+                conn.message += payload;
+                if (fin && client) {
+                    ws->injectMessage(client, (const uint8_t*)conn.message.data(), conn.message.size(),
+                                      conn.messageOpcode == 0x2 ? WS_BINARY : WS_TEXT);
+                    conn.message.clear();
+                }
+                break;
+            case 0x8:  // Close
+                appendFrame(conn.out, 0x8, payload.data(), std::min<size_t>(payload.size(), 2));
+                conn.closing = true;
+                return;
+            case 0x9:  // Ping
+                appendFrame(conn.out, 0xA, payload.data(), payload.size());
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// Move queued messages into the socket buffer while the socket keeps up
+static void drainOutbox(Connection& conn) {
+    AsyncWebSocketClient* client = ws->client(conn.clientId);
+    if (!client) {
+        // Closed by the dashboard
+        if (!conn.closing) appendFrame(conn.out, 0x8, "\x03\xE8", 2);
+        conn.closing = true;
+        return;
+    }
+    while (!client->outbox.empty() && conn.out.size() < SOCKET_BACKLOG) {
+        const auto& msg = client->outbox.front();
+        appendFrame(conn.out, msg.binary ? 0x2 : 0x1, msg.data.data(), msg.data.size());
+        client->outbox.pop_front();
+    }
+}
+
+static void closeConnection(std::list<Connection>::iterator it) {
+    if (it->clientId) {
+        AsyncWebSocketClient* client = ws->client(it->clientId);
+        if (client) ws->injectDisconnect(client);
+    }
+    close(it->fd);
+    connections.erase(it);
+}
+
+// ---------------------------------------------------------------------------
+// Demo dashboard
+// ---------------------------------------------------------------------------
+
+static void setupDashboard() {
+    dashboard.begin(&server, DASHBOARD_ASSETS, DASHBOARD_ASSET_COUNT);
+    dashboard.setVersionInfo("host", __DATE__);
+    dashboard.setActionTracing(true);  // Acks give scripts/dashboard_load.py its action latency
+    dashboard.addStatCard("temp", "Temperature", "23.5", "C");
+    dashboard.addGaugeCard("cpu", "CPU", 0, 100, "%");
+    ChartCard* chart = dashboard.addChartCard("power", "Power", ChartType::LINE, 30);
+    chart->addSeries("Phase A");
+    chart->addSeries("Phase B", "warning");
+    dashboard.addToggleCard("led", "LED", "Status LED", false);
+    SliderCard* slider = dashboard.addSliderCard("level", "Level", 0, 255, 1, "");
+    slider->onChange = [](int value) { dashboard.updateGaugeCard("cpu", value * 100.0f / 255); };
+    dashboard.onCommand([](const String& command) {
+        dashboard.log(LogLevel::INFO, "Command: " + command);
+    });
+}
+
+static void publishReadings() {
+    static float t = 0;
+    t += 0.1f;
+    dashboard.updateStatCard("temp", String(23.5f + sinf(t) * 2, 1));
+    dashboard.updateGaugeCard("cpu", 50 + sinf(t * 3) * 40);
+    dashboard.updateChartCard("power", 0, 120 + sinf(t) * 30);
+    dashboard.updateChartCard("power", 1, 100 + cosf(t) * 25);
+}
+
+int main(int argc, char** argv) {
+    int port = argc > 1 ? atoi(argv[1]) : 8080;
+    unsigned long updateMs = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000;
+    const char* recordPath = argc > 3 ? argv[3] : nullptr;
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, [](int) { stopRequested = 1; });
+    signal(SIGTERM, [](int) { stopRequested = 1; });
+
+    setupDashboard();
+    ws = server.sockets().front();
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 128) != 0) {
+        perror("[native] listen");
+        return 1;
+    }
+    fcntl(listener, F_SETFL, O_NONBLOCK);
+    printf("[native] Dashboard on http://localhost:%d/ (updates every %lu ms)\n", port, updateMs);
+    
+    FILE* recordFile = recordPath ? fopen(recordPath, "wb") : nullptr;
+    FilePrint recordOut(recordFile);
+    if (recordPath && (!recordFile || !dashboard.startRecording(recordOut))) {
+        perror("[native] record");
+        return 1;
+    }
+
+    unsigned long lastUpdate = 0;
+    std::vector<pollfd> fds;
+    std::vector<std::list<Connection>::iterator> owners;
+    while (!stopRequested) {
+        fds.clear();
+        owners.clear();
+        fds.push_back({ listener, POLLIN, 0 });
+        for (auto it = connections.begin(); it != connections.end(); ++it) {
+            fds.push_back({ it->fd, (short)(POLLIN | (it->out.empty() ? 0 : POLLOUT)), 0 });
+            owners.push_back(it);
+        }
+        poll(fds.data(), fds.size(), 5);
+
+        if (fds[0].revents & POLLIN) {
+            int fd;
+            while ((fd = accept(listener, nullptr, nullptr)) >= 0) {
+                fcntl(fd, F_SETFL, O_NONBLOCK);
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                connections.push_back(Connection{ fd });
+            }
+        }
+
+        for (size_t i = 0; i < owners.size(); i++) {
+            auto it = owners[i];
+            short revents = fds[i + 1].revents;
+            bool dead = revents & (POLLERR | POLLHUP);
+            if (revents & POLLIN) {
+                char buf[16384];
+                ssize_t n = read(it->fd, buf, sizeof(buf));
+                if (n > 0) {
+                    it->in.append(buf, n);
+                } else if (n == 0 || errno != EAGAIN) {
+                    dead = true;
+                }
+            }
+            if (!dead && !it->closing) {
+                if (it->clientId) handleFrames(*it);
+                else handleHttp(*it);
+            }
+            if (!dead && !it->out.empty()) {
+                ssize_t n = write(it->fd, it->out.data(), it->out.size());
+                if (n > 0) it->out.erase(0, n);
+                else if (n < 0 && errno != EAGAIN) dead = true;
+            }
+            if (dead || (it->closing && it->out.empty())) closeConnection(it);
+        }
+
+        if (millis() - lastUpdate >= updateMs) {
+            lastUpdate = millis();
+            publishReadings();
+        }
+        dashboard.loop();
+
+        for (auto& conn : connections) {
+            if (conn.clientId) drainOutbox(conn);
+        }
+    }
+    
+    if (recordFile) {
+        dashboard.stopRecording();
+        fclose(recordFile);
+        printf("[native] Recording written to %s (%u records dropped)\n", recordPath, dashboard.getDroppedRecords());
+    }
+    return 0;
+}
@@ -0,0 +1,251 @@
+/**
+ * Host shim: Arduino core subset
+ *
+ * Just enough of the Arduino API (String, Print, Serial, millis, ESP) for
+ * ESPDashboardPlus.h to compile and run on Linux in the `native` environment.
+ */
+
+#ifndef DASHBOARD_SHIM_ARDUINO_H
+#define DASHBOARD_SHIM_ARDUINO_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#define PROGMEM
+#define PGM_P const char*
+#define F(s) (s)
+#define FPSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define memcpy_P memcpy
+#define strlen_P strlen
+
+#define HIGH 1
+#define LOW 0
+#define OUTPUT 1
+#define INPUT 0
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+inline unsigned long millis() {
+    using namespace std::chrono;
+    static const steady_clock::time_point start = steady_clock::now();
+    return (unsigned long)duration_cast<milliseconds>(steady_clock::now() - start).count();
+}
+
+inline unsigned long micros() {
+    using namespace std::chrono;
+    static const steady_clock::time_point start = steady_clock::now();
+    return (unsigned long)duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+
+inline void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void yield() { std::this_thread::yield(); }
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline long random(long howsmall, long howbig) { return howsmall >= howbig ? howsmall : howsmall + rand() % (howbig - howsmall); }
+inline long random(long howbig) { return random(0, howbig); }
+
+template <typename T, typename L, typename H>
+inline T constrain(T amt, L low, H high) { return amt < (T)low ? (T)low : (amt > (T)high ? (T)high : amt); }
+
+/**
+ * Arduino String on top of std::string
+ */
+class String {
+public:
+    String() {}
+    String(const char* s) : _s(s ? s : "") {}
+    String(const char* s, size_t len) : _s(s ? s : "", s ? len : 0) {}
+    String(const std::string& s) : _s(s) {}
+    String(char c) : _s(1, c) {}
+    String(int v, unsigned char base = 10) { fromLong(v, base); }
+    String(unsigned int v, unsigned char base = 10) { fromULong(v, base); }
+    String(long v, unsigned char base = 10) { fromLong(v, base); }
+    String(unsigned long v, unsigned char base = 10) { fromULong(v, base); }
+    String(long long v, unsigned char base = 10) { fromLong(v, base); }
+    String(unsigned long long v, unsigned char base = 10) { fromULong(v, base); }
+    String(float v, unsigned int decimals = 2) { fromDouble(v, decimals); }
+    String(double v, unsigned int decimals = 2) { fromDouble(v, decimals); }
+
+    unsigned int length() const { return (unsigned int)_s.size(); }
+    const char* c_str() const { return _s.c_str(); }
+    bool isEmpty() const { return _s.empty(); }
+    bool reserve(unsigned int size) { _s.reserve(size); return true; }
+    void clear() { _s.clear(); }
+
+    char operator[](unsigned int i) const { return i < _s.size() ? _s[i] : 0; }
+    char& operator[](unsigned int i) { return _s[i]; }
+    char charAt(unsigned int i) const { return (*this)[i]; }
+
+    bool concat(const String& s) { _s += s._s; return true; }
+    bool concat(const char* s) { if (s) _s += s; return true; }
+    bool concat(const char* s, unsigned int len) { if (s) _s.append(s, len); return true; }
+    bool concat(char c) { _s += c; return true; }
+    template <typename T> bool concat(T v) { return concat(String(v)); }
+
+    String& operator+=(const String& s) { concat(s); return *this; }
+    String& operator+=(const char* s) { concat(s); return *this; }
+    String& operator+=(char c) { concat(c); return *this; }
+    template <typename T> String& operator+=(T v) { concat(String(v)); return *this; }
+
+    bool equals(const String& s) const { return _s == s._s; }
+    bool operator==(const String& s) const { return _s == s._s; }
+    bool operator==(const char* s) const { return _s == (s ? s : ""); }
+    bool operator!=(const String& s) const { return _s != s._s; }
+    bool operator!=(const char* s) const { return !(*this == s); }
+    bool operator<(const String& s) const { return _s < s._s; }
+    bool operator>(const String& s) const { return _s > s._s; }
+
+    bool startsWith(const String& p) const { return _s.compare(0, p._s.size(), p._s) == 0; }
+    bool endsWith(const String& p) const {
+        return _s.size() >= p._s.size() && _s.compare(_s.size() - p._s.size(), p._s.size(), p._s) == 0;
+    }
+    int indexOf(char c, unsigned int from = 0) const { size_t p = _s.find(c, from); return p == std::string::npos ? -1 : (int)p; }
+    int indexOf(const String& s, unsigned int from = 0) const { size_t p = _s.find(s._s, from); return p == std::string::npos ? -1 : (int)p; }
+    int lastIndexOf(char c) const { size_t p = _s.rfind(c); return p == std::string::npos ? -1 : (int)p; }
+    String substring(unsigned int from) const { return from >= _s.size() ? String() : String(_s.substr(from)); }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to) std::swap(from, to);
+        if (from >= _s.size()) return String();
+        return String(_s.substr(from, to - from));
+    }
+    void trim() {
+        size_t b = _s.find_first_not_of(" \t\r\n");
+        size_t e = _s.find_last_not_of(" \t\r\n");
+        _s = b == std::string::npos ? std::string() : _s.substr(b, e - b + 1);
+    }
+    void toLowerCase() { for (auto& c : _s) c = (char)tolower((unsigned char)c); }
+    void toUpperCase() { for (auto& c : _s) c = (char)toupper((unsigned char)c); }
+    void replace(const String& from, const String& to) {
+        if (from._s.empty()) return;
+        size_t pos = 0;
+        while ((pos = _s.find(from._s, pos)) != std::string::npos) {
+            _s.replace(pos, from._s.size(), to._s);
+            pos += to._s.size();
+        }
+    }
+    long toInt() const { return strtol(_s.c_str(), nullptr, 10); }
+    float toFloat() const { return strtof(_s.c_str(), nullptr); }
+    double toDouble() const { return strtod(_s.c_str(), nullptr); }
+
+    // Used by ArduinoJson's Arduino String adapter
+    size_t write(uint8_t c) { _s += (char)c; return 1; }
+    size_t write(const uint8_t* buf, size_t len) { _s.append((const char*)buf, len); return len; }
+
+    const std::string& str() const { return _s; }
+
+private:
+    std::string _s;
+
+    void fromLong(long long v, unsigned char base) {
+        if (base == 10) { _s = std::to_string(v); return; }
+        if (v < 0) { fromULong((unsigned long long)(-v), base); _s.insert(0, 1, '-'); return; }
+        fromULong((unsigned long long)v, base);
+    }
+    void fromULong(unsigned long long v, unsigned char base) {
+        if (base == 10) { _s = std::to_string(v); return; }
+        char buf[66];
+        int i = 64;
+        buf[65] = 0;
+        do { int d = v % base; buf[i--] = (char)(d < 10 ? '0' + d : 'a' + d - 10); v /= base; } while (v && i >= 0);
+        _s = &buf[i + 1];
+    }
+    void fromDouble(double v, unsigned int decimals) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+        _s = buf;
+    }
+};
+
+inline String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+inline String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, char b) { String r(a); r += b; return r; }
+template <typename T> inline String operator+(const String& a, T b) { String r(a); r += String(b); return r; }
+inline bool operator==(const char* a, const String& b) { return b == a; }
+
+/**
+ * Print - byte sink with the usual print/printf helpers
+ */
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t len) {
+        size_t n = 0;
+        while (len--) n += write(*buf++);
+        return n;
+    }
+    size_t write(const char* s) { return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+    size_t write(const char* buf, size_t len) { return write((const uint8_t*)buf, len); }
+
+    size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+    size_t print(const char* s) { return write(s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v) { return print(String(v)); }
+    size_t print(unsigned int v) { return print(String(v)); }
+    size_t print(long v) { return print(String(v)); }
+    size_t print(unsigned long v) { return print(String(v)); }
+    size_t print(double v, int d = 2) { return print(String(v, d)); }
+    template <typename T> size_t println(const T& v) { return print(v) + println(); }
+    size_t println() { return write("\n"); }
+
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        char buf[256];
+        va_list args;
+        va_start(args, fmt);
+        int len = vsnprintf(buf, sizeof(buf), fmt, args);
+        va_end(args);
+        if (len < 0) return 0;
+        if ((size_t)len < sizeof(buf)) return write((const uint8_t*)buf, len);
+        std::string big(len + 1, '\0');
+        va_start(args, fmt);
+        vsnprintf(&big[0], big.size(), fmt, args);
+        va_end(args);
+        return write((const uint8_t*)big.data(), len);
+    }
+    virtual void flush() {}
+};
+
+/**
+ * Serial - writes to stdout (set quiet to silence library chatter in benchmarks)
+ */
+class HostSerial : public Print {
+public:
+    bool quiet = false;
+    void begin(unsigned long) {}
+    size_t write(uint8_t c) override { if (!quiet) fputc(c, stdout); return 1; }
+    size_t write(const uint8_t* buf, size_t len) override { if (!quiet) fwrite(buf, 1, len, stdout); return len; }
+    using Print::write;
+    int available() { return 0; }
+    int read() { return -1; }
+    operator bool() const { return true; }
+};
+
+inline HostSerial Serial;
+
+/**
+ * ESP - heap statistics are not meaningful on the host; report a fixed budget
+ */
+class HostESP {
+public:
+    uint32_t getFreeHeap() { return 256 * 1024; }
+    uint32_t getMaxAllocHeap() { return 128 * 1024; }
+    uint32_t getMinFreeHeap() { return 256 * 1024; }
+    uint32_t getHeapSize() { return 320 * 1024; }
+    // Reported, not performed: the host process keeps serving after an OTA update
+    void restart() { printf("[ESP] restart requested\n"); }
+};
+
+inline HostESP ESP;
+
+#endif // DASHBOARD_SHIM_ARDUINO_H
@@ -0,0 +1,395 @@
+/**
+ * Host shim: ESPAsyncWebServer subset with in-memory loopback
+ *
+ * Handlers and WebSocket events run synchronously on the calling thread.
+ * Host programs drive the server through the inject*() / request() helpers
+ * and read what the dashboard sent from each client's outbox.
+ */
+
+#ifndef DASHBOARD_SHIM_ASYNC_WEB_SERVER_H
+#define DASHBOARD_SHIM_ASYNC_WEB_SERVER_H
+
+#include <Arduino.h>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+typedef enum {
+    HTTP_GET = 0b00000001,
+    HTTP_POST = 0b00000010,
+    HTTP_DELETE = 0b00000100,
+    HTTP_PUT = 0b00001000,
+    HTTP_PATCH = 0b00010000,
+    HTTP_HEAD = 0b00100000,
+    HTTP_OPTIONS = 0b01000000,
+    HTTP_ANY = 0b01111111,
+} WebRequestMethod;
+
+typedef enum { WS_CONTINUATION, WS_TEXT, WS_BINARY, WS_DISCONNECT = 0x08, WS_PING, WS_PONG } AwsFrameType;
+typedef enum { WS_DISCONNECTED, WS_CONNECTED, WS_DISCONNECTING } AwsClientStatus;
+typedef enum { WS_EVT_CONNECT, WS_EVT_DISCONNECT, WS_EVT_PING, WS_EVT_PONG, WS_EVT_ERROR, WS_EVT_DATA } AwsEventType;
+
+typedef struct {
+    uint8_t message_opcode;
+    uint32_t num;
+    uint8_t final;
+    uint8_t masked;
+    uint8_t opcode;
+    uint64_t len;
+    uint8_t mask[4];
+    uint64_t index;
+} AwsFrameInfo;
+
+#ifndef WS_MAX_QUEUED_MESSAGES
+#define WS_MAX_QUEUED_MESSAGES 32
+#endif
+
+class AsyncWebSocket;
+
+/**
+ * Loopback WebSocket client. Outbound messages accumulate in `outbox` until
+ * the host program drains them; the queue limit mirrors the real library.
+ */
+class AsyncWebSocketClient {
+public:
+    struct Message {
+        bool binary;
+        std::string data;
+    };
+
+    AsyncWebSocketClient(AsyncWebSocket* server, uint32_t id) : _server(server), _id(id) {}
+
+    uint32_t id() const { return _id; }
+    AwsClientStatus status() const { return _status; }
+    AsyncWebSocket* server() { return _server; }
+
+    bool queueIsFull() const { return outbox.size() >= WS_MAX_QUEUED_MESSAGES && !unboundedOutbox; }
+    size_t queueLen() const { return outbox.size(); }
+    bool canSend() const { return !queueIsFull(); }
+
+    bool text(const char* message, size_t len) { return enqueue(false, message, len); }
+    bool text(const char* message) { return text(message, strlen(message)); }
+    bool text(const String& message) { return text(message.c_str(), message.length()); }
+    bool binary(const uint8_t* message, size_t len) { return enqueue(true, (const char*)message, len); }
+    bool binary(const char* message, size_t len) { return enqueue(true, message, len); }
+    void ping(const uint8_t* = nullptr, size_t = 0) {}
+    void close(uint16_t = 0, const char* = nullptr) { _status = WS_DISCONNECTING; }
+
+    // Host helpers
+    std::deque<Message> outbox;
+    bool unboundedOutbox = true;
+    size_t droppedMessages = 0;
+    std::function<void(const Message&)> onSend;
+
+private:
+    friend class AsyncWebSocket;
+    AsyncWebSocket* _server;
+    uint32_t _id;
+    AwsClientStatus _status = WS_CONNECTED;
+
+    bool enqueue(bool binary, const char* data, size_t len) {
+        if (_status != WS_CONNECTED) return false;
+        if (queueIsFull()) {
+            droppedMessages++;
+            return false;
+        }
+        outbox.push_back({binary, std::string(data, len)});
+        if (onSend) onSend(outbox.back());
+        return true;
+    }
+};
+
+typedef std::function<void(AsyncWebSocket*, AsyncWebSocketClient*, AwsEventType, void*, uint8_t*, size_t)> AwsEventHandler;
+
+class AsyncWebHandler {
+public:
+    virtual ~AsyncWebHandler() {}
+};
+
+class AsyncWebSocket : public AsyncWebHandler {
+public:
+    explicit AsyncWebSocket(const String& url) : _url(url) {}
+
+    const char* url() const { return _url.c_str(); }
+    void onEvent(AwsEventHandler handler) { _handler = handler; }
+
+    size_t count() const {
+        size_t n = 0;
+        for (const auto& c : _clients) if (c.status() == WS_CONNECTED) n++;
+        return n;
+    }
+    AsyncWebSocketClient* client(uint32_t id) {
+        for (auto& c : _clients) if (c.id() == id && c.status() == WS_CONNECTED) return &c;
+        return nullptr;
+    }
+    bool hasClient(uint32_t id) { return client(id) != nullptr; }
+    std::list<AsyncWebSocketClient>& getClients() { return _clients; }
+
+    void textAll(const char* message, size_t len) { for (auto& c : _clients) c.text(message, len); }
+    void textAll(const char* message) { textAll(message, strlen(message)); }
+    void textAll(const String& message) { textAll(message.c_str(), message.length()); }
+    void binaryAll(const uint8_t* message, size_t len) { for (auto& c : _clients) c.binary(message, len); }
+    void text(uint32_t id, const String& message) { if (auto* c = client(id)) c->text(message); }
+    void binary(uint32_t id, const uint8_t* message, size_t len) { if (auto* c = client(id)) c->binary(message, len); }
+    bool availableForWriteAll() {
+        for (auto& c : _clients) if (c.queueIsFull()) return false;
+        return true;
+    }
+    void closeAll(uint16_t code = 0, const char* message = nullptr) { for (auto& c : _clients) c.close(code, message); }
+
+    void cleanupClients(uint16_t maxClients = 8) {
+        _clients.remove_if([](const AsyncWebSocketClient& c) { return c.status() != WS_CONNECTED; });
+        (void)maxClients;
+    }
+
+    // ---- Host helpers ----
+
+    AsyncWebSocketClient* injectConnect() {
+        _clients.emplace_back(this, ++_nextId);
+        AsyncWebSocketClient* c = &_clients.back();
+        if (_handler) _handler(this, c, WS_EVT_CONNECT, nullptr, nullptr, 0);
+        return c;
+    }
+
+    void injectDisconnect(AsyncWebSocketClient* c) {
+        if (!c || c->_status == WS_DISCONNECTED) return;
+        c->_status = WS_DISCONNECTED;
+        if (_handler) _handler(this, c, WS_EVT_DISCONNECT, nullptr, nullptr, 0);
+    }
+
+    // Deliver one complete message, optionally split into frames of fragmentSize bytes
+    void injectMessage(AsyncWebSocketClient* c, const uint8_t* data, size_t len,
+                       AwsFrameType opcode = WS_TEXT, size_t fragmentSize = 0) {
+        if (!_handler || !c) return;
+        if (fragmentSize == 0 || fragmentSize >= len) fragmentSize = len;
+        std::vector<uint8_t> frame;
+        size_t offset = 0;
+        uint32_t num = 0;
+        do {
+            size_t n = std::min(fragmentSize, len - offset);
+            AwsFrameInfo info = {};
+            info.message_opcode = opcode;
+            info.opcode = num == 0 ? opcode : WS_CONTINUATION;
+            info.num = num++;
+            info.final = offset + n >= len;
+            info.len = len;
+            info.index = offset;
+            frame.assign(data + offset, data + offset + n);
+            _handler(this, c, WS_EVT_DATA, &info, frame.data(), n);
+            offset += n;
+        } while (offset < len);
+    }
+
+    void injectText(AsyncWebSocketClient* c, const String& message, size_t fragmentSize = 0) {
+        injectMessage(c, (const uint8_t*)message.c_str(), message.length(), WS_TEXT, fragmentSize);
+    }
+
+private:
+    String _url;
+    AwsEventHandler _handler;
+    std::list<AsyncWebSocketClient> _clients;  // as in ESPAsyncWebServer 3.x
+    uint32_t _nextId = 0;
+};
+
+/**
+ * HTTP side
+ */
+class AsyncWebHeader {
+public:
+    AsyncWebHeader(const String& name, const String& value) : _name(name), _value(value) {}
+    const String& name() const { return _name; }
+    const String& value() const { return _value; }
+private:
+    String _name;
+    String _value;
+};
+
+class AsyncWebParameter {
+public:
+    AsyncWebParameter(const String& name, const String& value) : _name(name), _value(value) {}
+    const String& name() const { return _name; }
+    const String& value() const { return _value; }
+private:
+    String _name;
+    String _value;
+};
+
+typedef std::function<size_t(uint8_t*, size_t, size_t)> AwsResponseFiller;
+
+class AsyncWebServerResponse {
+public:
+    virtual ~AsyncWebServerResponse() {}
+    void addHeader(const String& name, const String& value) { headers.push_back({name, value}); }
+    void setCode(int c) { code = c; }
+    void setContentType(const String& type) { contentType = type; }
+
+    // Render the full body (chunked/filler responses are drained completely)
+    virtual std::string body() { return std::string(); }
+
+    int code = 200;
+    String contentType;
+    std::vector<AsyncWebHeader> headers;
+};
+
+class AsyncBasicResponse : public AsyncWebServerResponse {
+public:
+    AsyncBasicResponse(int c, const String& type, const std::string& content) : _content(content) {
+        code = c;
+        contentType = type;
+    }
+    std::string body() override { return _content; }
+private:
+    std::string _content;
+};
+
+class AsyncCallbackResponse : public AsyncWebServerResponse {
+public:
+    AsyncCallbackResponse(int c, const String& type, size_t len, AwsResponseFiller filler)
+        : _len(len), _filler(filler) {
+        code = c;
+        contentType = type;
+    }
+    std::string body() override {
+        std::string out;
+        uint8_t buf[1460];
+        size_t index = 0;
+        for (;;) {
+            size_t n = _filler(buf, sizeof(buf), index);
+            if (n == 0) break;
+            out.append((const char*)buf, n);
+            index += n;
+            if (_len && index >= _len) break;
+        }
+        return out;
+    }
+private:
+    size_t _len;
+    AwsResponseFiller _filler;
+};
+
+class AsyncResponseStream : public AsyncWebServerResponse, public Print {
+public:
+    AsyncResponseStream(const String& type) { contentType = type; }
+    size_t write(uint8_t c) override { _content += (char)c; return 1; }
+    size_t write(const uint8_t* buf, size_t len) override { _content.append((const char*)buf, len); return len; }
+    using Print::write;
+    std::string body() override { return _content; }
+private:
+    std::string _content;
+};
+
+#define RESPONSE_TRY_AGAIN 0xFFFFFFFF
+
+class AsyncWebServerRequest {
+public:
+    AsyncWebServerRequest(WebRequestMethod method, const String& url) : _method(method), _url(url) {}
+
+    WebRequestMethod method() const { return _method; }
+    const String& url() const { return _url; }
+
+    bool hasHeader(const String& name) const { return getHeader(name) != nullptr; }
+    const AsyncWebHeader* getHeader(const String& name) const {
+        for (const auto& h : _headers) {
+            String a = h.name(), b = name;
+            a.toLowerCase();
+            b.toLowerCase();
+            if (a == b) return &h;
+        }
+        return nullptr;
+    }
+    const String& header(const char* name) const {
+        static const String empty;
+        const AsyncWebHeader* h = getHeader(name);
+        return h ? h->value() : empty;
+    }
+    bool hasParam(const String& name) const { return getParam(name) != nullptr; }
+    const AsyncWebParameter* getParam(const String& name) const {
+        for (const auto& p : _params) if (p.name() == name) return &p;
+        return nullptr;
+    }
+
+    AsyncWebServerResponse* beginResponse(int code, const String& type = String(), const String& content = String()) {
+        return new AsyncBasicResponse(code, type, content.str());
+    }
+    AsyncWebServerResponse* beginResponse(int code, const String& type, const uint8_t* content, size_t len) {
+        return new AsyncBasicResponse(code, type, std::string((const char*)content, len));
+    }
+    AsyncWebServerResponse* beginResponse_P(int code, const String& type, const uint8_t* content, size_t len) {
+        return beginResponse(code, type, content, len);
+    }
+    AsyncWebServerResponse* beginResponse(const String& type, size_t len, AwsResponseFiller filler) {
+        return new AsyncCallbackResponse(200, type, len, filler);
+    }
+    AsyncWebServerResponse* beginChunkedResponse(const String& type, AwsResponseFiller filler) {
+        return new AsyncCallbackResponse(200, type, 0, filler);
+    }
+    AsyncResponseStream* beginResponseStream(const String& type) { return new AsyncResponseStream(type); }
+
+    void send(AsyncWebServerResponse* response) { _response.reset(response); }
+    void send(int code, const String& type = String(), const String& content = String()) {
+        send(beginResponse(code, type, content));
+    }
+
+    // Host helpers
+    void addHeader(const String& name, const String& value) { _headers.emplace_back(name, value); }
+    void addParam(const String& name, const String& value) { _params.emplace_back(name, value); }
+    AsyncWebServerResponse* response() { return _response.get(); }
+
+private:
+    WebRequestMethod _method;
+    String _url;
+    std::vector<AsyncWebHeader> _headers;
+    std::vector<AsyncWebParameter> _params;
+    std::unique_ptr<AsyncWebServerResponse> _response;
+};
+
+typedef std::function<void(AsyncWebServerRequest*)> ArRequestHandlerFunction;
+
+class AsyncWebServer {
+public:
+    explicit AsyncWebServer(uint16_t port = 80) : _port(port) {}
+
+    void begin() {}
+    void end() {}
+    uint16_t port() const { return _port; }
+
+    void on(const char* uri, WebRequestMethod method, ArRequestHandlerFunction handler) {
+        _routes.push_back({String(uri), method, handler});
+    }
+    void on(const char* uri, ArRequestHandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+    AsyncWebHandler& addHandler(AsyncWebHandler* handler) {
+        if (AsyncWebSocket* ws = dynamic_cast<AsyncWebSocket*>(handler)) _sockets.push_back(ws);
+        return *handler;
+    }
+    void onNotFound(ArRequestHandlerFunction handler) { _notFound = handler; }
+
+    // Host helpers: dispatch a request to the matching route (exact URI match)
+    bool handle(AsyncWebServerRequest& request) {
+        for (auto& r : _routes) {
+            if (r.uri == request.url() && (r.method & request.method())) {
+                r.handler(&request);
+                return true;
+            }
+        }
+        if (_notFound) _notFound(&request);
+        return false;
+    }
+    const std::vector<AsyncWebSocket*>& sockets() const { return _sockets; }
+
+private:
+    struct Route {
+        String uri;
+        WebRequestMethod method;
+        ArRequestHandlerFunction handler;
+    };
+    uint16_t _port;
+    std::vector<Route> _routes;
+    std::vector<AsyncWebSocket*> _sockets;
+    ArRequestHandlerFunction _notFound;
+};
+
+#endif // DASHBOARD_SHIM_ASYNC_WEB_SERVER_H
@@ -0,0 +1,51 @@
+/**
+ * Host shim: Update (OTA) - counts bytes instead of writing flash
+ */
+
+#ifndef DASHBOARD_SHIM_UPDATE_H
+#define DASHBOARD_SHIM_UPDATE_H
+
+#include <Arduino.h>
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+
+class HostUpdateClass {
+public:
+    bool begin(size_t size = UPDATE_SIZE_UNKNOWN) {
+        _size = size;
+        _written = 0;
+        _running = true;
+        _error = 0;
+        return true;
+    }
+    size_t write(uint8_t* data, size_t len) {
+        if (!_running) return 0;
+        _written += len;
+        return len;
+    }
+    bool end(bool evenIfRemaining = false) {
+        if (!_running) return false;
+        _running = false;
+        if (!evenIfRemaining && _size != UPDATE_SIZE_UNKNOWN && _written != _size) {
+            _error = 1;
+            return false;
+        }
+        return true;
+    }
+    void abort() { _running = false; _error = 2; }
+    bool hasError() const { return _error != 0; }
+    bool isRunning() const { return _running; }
+    size_t size() const { return _size; }
+    size_t progress() const { return _written; }
+    void printError(Print& out) { out.printf("Update error %d\n", _error); }
+
+private:
+    size_t _size = 0;
+    size_t _written = 0;
+    bool _running = false;
+    int _error = 0;
+};
+
+inline HostUpdateClass Update;
+
+#endif // DASHBOARD_SHIM_UPDATE_H
@@ -0,0 +1,10 @@
+/**
+ * Host shim: pgmspace.h - flash and RAM are the same on the host
+ */
+
+#ifndef DASHBOARD_SHIM_PGMSPACE_H
+#define DASHBOARD_SHIM_PGMSPACE_H
+
+#include <Arduino.h>
+
+#endif // DASHBOARD_SHIM_PGMSPACE_H
@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+"""
+Compare two runs of the host benchmarks (extras/native/bench.cpp)
+
+Both files hold one JSON object per line as printed by the benchmark binary.
+Prints the change of every metric per benchmark and exits with status 1 if
+any benchmark got slower or allocates more than the threshold allows.
+
+Usage:
+    pio run -e native-bench -t exec > bench.jsonl
+    python scripts/bench_compare.py baseline.jsonl bench.jsonl [--threshold 10]
+"""
+
+import argparse
+import json
+import sys
+
+# Metrics where a higher value is a regression
+METRICS = ['ns_per_op', 'alloc_bytes_per_op', 'allocs_per_op', 'wire_bytes_per_op']
+
+
+def load(path):
+    """Read a JSON-lines benchmark run into {name: result}."""
+    results = {}
+    with open(path, 'r', encoding='utf-8') as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith('{'):
+                continue  # Tolerate build or library output mixed into the file
+            result = json.loads(line)
+            results[result['name']] = result
+    return results
+
+
+def change(old, new):
+    """Relative change in percent (0 when both are zero)."""
+    if old == 0:
+        return 0.0 if new == 0 else float('inf')
+    return (new - old) / old * 100
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compare two host benchmark runs')
+    parser.add_argument('baseline', help='JSON lines of the reference run')
+    parser.add_argument('current', help='JSON lines of the run to check')
+    parser.add_argument('--threshold', type=float, default=10.0,
+                        help='Allowed increase in percent before a metric counts as a regression (default: 10)')
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+
+    regressions = []
+    print(f"{'benchmark':<44} {'metric':<20} {'baseline':>12} {'current':>12} {'change':>9}")
+    for name, result in current.items():
+        if name not in baseline:
+            print(f"{name:<44} (new)")
+            continue
+        for metric in METRICS:
+            old = baseline[name].get(metric, 0)
+            new = result.get(metric, 0)
+            delta = change(old, new)
+            flag = ''
+            if delta > args.threshold:
+                flag = '  REGRESSION'
+                regressions.append((name, metric))
+            print(f"{name:<44} {metric:<20} {old:>12.1f} {new:>12.1f} {delta:>+8.1f}%{flag}")
+
+    for name in baseline:
+        if name not in current:
+            print(f"{name:<44} (missing from current run)")
+
+    if regressions:
+        print(f"\n{len(regressions)} regression(s) above {args.threshold:.0f}%")
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,458 @@
+#!/usr/bin/env python3
+"""
+ESP Dashboard - Page Build Stages
+
+Shared by html_to_header.py and html_to_header_pio.py. Turns
+extras/dashboard.html into the page that goes into flash:
+
+1. Card stripping: blocks wrapped in card markers are dropped unless one of
+   their card types is in the project's manifest. The markers are comments in
+   the syntax of the surrounding code:
+
+       /* @card chart */ ... /* @end */          (styles)
+       // @card chart ... // @end                (script, on their own lines)
+       <!-- @card ota --> ... <!-- @end -->      (markup)
+
+   A marker may list several types ("@card input location"); the block stays
+   if any of them is used. "ota" covers the firmware update tab and "action"
+   the confirm dialog.
+
+2. Minification of the inline CSS, the inline JS and the markup. The JS pass
+   only removes comments and whitespace and keeps line breaks where automatic
+   semicolon insertion could depend on them, so it needs no JS parser.
+
+3. Compression into the encodings the firmware serves: gzip always works,
+   Brotli needs the brotli (or brotlicffi) Python package.
+
+4. Output as PROGMEM arrays for dashboard_html.h and, optionally, as files
+   for a filesystem image (index.html.gz, app.<hash>.js.br, ...).
+
+Standard library only, apart from the optional Brotli package.
+"""
+
+import gzip
+import hashlib
+import os
+import re
+
+# ---------------------------------------------------------------------------
+# Card stripping
+# ---------------------------------------------------------------------------
+
+_MARKER = re.compile(r'^\s*(?:/\*|//|<!--)\s*@(card\s+[\w\s]+?|end)\s*(?:\*/|-->)?\s*$')
+
+
+def parse_cards(value):
+    """Manifest string ("stat, gauge chart") -> set of card types, None if empty."""
+    if not value:
+        return None
+    cards = {c.strip().lower() for c in re.split(r'[\s,]+', value) if c.strip()}
+    return cards or None
+
+
+def card_types(source):
+    """All card types that have markers in the page."""
+    types = set()
+    for line in source.split('\n'):
+        m = _MARKER.match(line)
+        if m and m.group(1) != 'end':
+            types.update(m.group(1).split()[1:])
+    return types
+
+
+def strip_cards(source, cards):
+    """Drop marked blocks whose types are not in cards (None keeps all) and the markers themselves."""
+    out = []
+    keep = True
+    depth = 0
+    for number, line in enumerate(source.split('\n'), 1):
+        m = _MARKER.match(line)
+        if not m:
+            if keep:
+                out.append(line)
+            continue
+        if m.group(1) == 'end':
+            if depth == 0:
+                raise ValueError(f'line {number}: @end without @card')
+            depth = 0
+            keep = True
+        else:
+            if depth:
+                raise ValueError(f'line {number}: nested @card block')
+            depth = 1
+            keep = cards is None or any(t in cards for t in m.group(1).split()[1:])
+    if depth:
+        raise ValueError('unterminated @card block')
+    return '\n'.join(out)
+
+
+# ---------------------------------------------------------------------------
+# CSS
+# ---------------------------------------------------------------------------
+
+_CSS_STRING = re.compile(r'"(?:\\.|[^"\\])*"|\'(?:\\.|[^\'\\])*\'')
+
+
+def _squeeze_css(css):
+    css = re.sub(r'/\*.*?\*/', '', css, flags=re.S)
+    css = re.sub(r'\s+', ' ', css)
+    css = re.sub(r'\s*([{};,>])\s*', r'\1', css)
+    css = re.sub(r':\s+', ':', css)
+    return css.replace(';}', '}')
+
+
+def minify_css(css):
+    """Remove comments and whitespace; string contents (attribute selectors, fonts) are kept."""
+    parts = []
+    last = 0
+    for m in _CSS_STRING.finditer(css):
+        parts.append(_squeeze_css(css[last:m.start()]))
+        parts.append(m.group())
+        last = m.end()
+    parts.append(_squeeze_css(css[last:]))
+    return ''.join(parts).strip()
+
+
+# ---------------------------------------------------------------------------
+# JS
+# ---------------------------------------------------------------------------
+
+# Literals are swapped for placeholders while the code between them is squeezed
+_PH_OPEN, _PH_CLOSE = '\ue000', '\ue001'
+_PH = re.compile(_PH_OPEN + r'(\d+)' + _PH_CLOSE)
+
+# Whitespace next to these never separates two tokens that would otherwise merge
+_JS_PUNCT = '{}()[];,:=<>?|&!'
+# A line ending or starting with one of these cannot end a statement there
+_JS_JOIN_AFTER = set('{([,;:=&|?<>')
+_JS_JOIN_BEFORE = set('})],;.?:')
+# After these keywords a '/' starts a regular expression
+_JS_REGEX_KEYWORDS = {'return', 'typeof', 'case', 'do', 'else', 'in', 'of', 'new', 'delete', 'void', 'throw'}
+
+
+def _regex_allowed(code):
+    """True if a '/' after this code starts a regular expression rather than a division."""
+    stripped = code.rstrip()
+    if not stripped:
+        return True
+    last = stripped[-1]
+    if last == _PH_CLOSE or last in ')]':
+        return False
+    if last.isalnum() or last in '_$':
+        word = re.search(r'[\w$]+$', stripped).group()
+        return word in _JS_REGEX_KEYWORDS
+    return True
+
+
+def _tokenize_js(src):
+    """Split JS into code (with placeholders) and the literals the placeholders stand for."""
+    code = []
+    literals = []
+    stack = []  # Open template literals: brace depth of the ${ } expression we are in
+    i, n = 0, len(src)
+
+    def literal(text):
+        code.append(f'{_PH_OPEN}{len(literals)}{_PH_CLOSE}')
+        literals.append(text)
+
+    def template_text(start):
+        """Scan template text from start; returns (end, closed) at '`' or '${'."""
+        j = start
+        while j < n:
+            c = src[j]
+            if c == '\\':
+                j += 2
+            elif c == '`':
+                return j + 1, True
+            elif c == '$' and src.startswith('${', j):
+                return j + 2, False
+            else:
+                j += 1
+        raise ValueError('unterminated template literal')
+
+    def squeeze_template(text):
+        # Template literals here hold markup: a whitespace run renders as one space
+        return re.sub(r'[ \t\r\n]{2,}|\n', lambda m: '\n' if '\n' in m.group() else ' ', text)
+
+    def open_template(start):
+        end, closed = template_text(start)
+        literal(squeeze_template(src[start - 1:end]))
+        if not closed:
+            stack.append(0)
+        return end
+
+    while i < n:
+        c = src[i]
+        if c in '"\'':
+            j = i + 1
+            while src[j] != c:
+                if src[j] == '\n':
+                    raise ValueError('unterminated string literal')
+                j += 2 if src[j] == '\\' else 1
+            literal(src[i:j + 1])
+            i = j + 1
+        elif c == '`':
+            i = open_template(i + 1)
+        elif stack and c == '{':
+            stack[-1] += 1
+            code.append(c)
+            i += 1
+        elif stack and c == '}':
+            if stack[-1]:
+                stack[-1] -= 1
+                code.append(c)
+                i += 1
+            else:
+                # End of a ${ } expression: back in template text
+                stack.pop()
+                end, closed = template_text(i + 1)
+                literal(squeeze_template(src[i:end]))
+                if not closed:
+                    stack.append(0)
+                i = end
+        elif src.startswith('//', i):
+            j = src.find('\n', i)
+            i = n if j < 0 else j
+        elif src.startswith('/*', i):
+            j = src.index('*/', i + 2)
+            code.append(' ')
+            i = j + 2
+        elif c == '/' and _regex_allowed(''.join(code[-64:])):
+            j = i + 1
+            in_class = False
+            while True:
+                ch = src[j]
+                if ch == '\\':
+                    j += 2
+                    continue
+                if ch == '\n':
+                    raise ValueError('unterminated regular expression')
+                if ch == '[':
+                    in_class = True
+                elif ch == ']':
+                    in_class = False
+                elif ch == '/' and not in_class:
+                    break
+                j += 1
+            j += 1
+            while j < n and (src[j].isalnum()):
+                j += 1  # Flags
+            literal(src[i:j])
+            i = j
+        else:
+            code.append(c)
+            i += 1
+    if stack:
+        raise ValueError('unterminated template literal')
+    return ''.join(code), literals
+
+
+def minify_js(src):
+    """Remove comments, indentation, blank lines and redundant spaces and line breaks."""
+    code, literals = _tokenize_js(src)
+
+    lines = []
+    for line in code.split('\n'):
+        line = re.sub(r'[ \t]+', ' ', line).strip()
+        line = re.sub(r' ?([' + re.escape(_JS_PUNCT) + r']) ?', r'\1', line)
+        if not line:
+            continue
+        if lines and (lines[-1][-1] in _JS_JOIN_AFTER or line[0] in _JS_JOIN_BEFORE):
+            lines[-1] += line
+        else:
+            lines.append(line)
+    code = '\n'.join(lines)
+    return _PH.sub(lambda m: literals[int(m.group(1))], code)
+
+
+# ---------------------------------------------------------------------------
+# Markup
+# ---------------------------------------------------------------------------
+
+_BLOCK = re.compile(r'(<style[^>]*>)(.*?)(</style>)|(<script[^>]*>)(.*?)(</script>)', re.S | re.I)
+
+
+def _squeeze_markup(markup):
+    markup = re.sub(r'<!--.*?-->', '', markup, flags=re.S)
+    # Whitespace between inline elements renders as one space, so runs collapse but never vanish
+    return re.sub(r'\s+', lambda m: '\n' if '\n' in m.group() else ' ', markup)
+
+
+def minify_html(html):
+    """Minify markup, inline <style> and inline <script> blocks."""
+    parts = []
+    last = 0
+    for m in _BLOCK.finditer(html):
+        parts.append(_squeeze_markup(html[last:m.start()]))
+        if m.group(1):
+            parts.append(m.group(1) + minify_css(m.group(2)) + m.group(3))
+        else:
+            parts.append(m.group(4) + minify_js(m.group(5)) + m.group(6))
+        last = m.end()
+    parts.append(_squeeze_markup(html[last:]))
+    return ''.join(parts).strip() + '\n'
+
+
+def build_page(html, cards=None, minify=True):
+    """Apply the build stages to the page source; returns the page as UTF-8 bytes."""
+    html = strip_cards(html, cards)
+    if minify:
+        html = minify_html(html)
+    return html.encode('utf-8')
+
+
+# ---------------------------------------------------------------------------
+# Compression
+# ---------------------------------------------------------------------------
+
+ENCODINGS = ('gzip', 'br')
+
+try:
+    import brotli
+except ImportError:
+    try:
+        import brotlicffi as brotli
+    except ImportError:
+        brotli = None
+
+
+_noted_brotli = []
+
+
+def parse_encodings(value):
+    """Encoding option ("gzip, br", "br") -> list of encodings in ENCODINGS order."""
+    wanted = {e.strip().lower() for e in re.split(r'[\s,]+', value or '') if e.strip()}
+    unknown = wanted - set(ENCODINGS)
+    if unknown:
+        raise ValueError(f"unknown encoding(s): {', '.join(sorted(unknown))} (use gzip and/or br)")
+    return [e for e in ENCODINGS if e in wanted] or list(ENCODINGS)
+
+
+def compress(data, encodings):
+    """{encoding: compressed bytes}. Brotli is skipped (with a note) if the package is missing,
+    unless it is the only encoding asked for."""
+    variants = {}
+    for encoding in encodings:
+        if encoding == 'gzip':
+            variants['gzip'] = gzip.compress(data, compresslevel=9)
+        elif brotli:
+            variants['br'] = brotli.compress(data, mode=brotli.MODE_TEXT, quality=11)
+        elif encodings == ['br']:
+            raise RuntimeError('Brotli-only build needs the brotli package: pip install brotli')
+        elif not _noted_brotli:
+            print('[ESP-DashboardPlus] Note: brotli package not installed, serving gzip only (pip install brotli)')
+            _noted_brotli.append(True)
+    return variants
+
+
+# ---------------------------------------------------------------------------
+# Assets
+# ---------------------------------------------------------------------------
+
+IMMUTABLE = 'public, max-age=31536000, immutable'
+
+
+def split_page(html):
+    """Move the inline <style> and <script> into content-hashed files.
+    Returns (shell, [(file name, content type, bytes), ...])."""
+    files = []
+
+    def extract(pattern, ext, content_type, tag):
+        nonlocal html
+        m = re.search(pattern, html, re.S | re.I)
+        if not m:
+            raise ValueError(f'no inline {ext} block to split out')
+        data = m.group(1).strip().encode('utf-8')
+        name = f'app.{hashlib.md5(data).hexdigest()[:8]}.{ext}'
+        html = html[:m.start()] + tag.format(name) + html[m.end():]
+        files.append((name, content_type, data))
+
+    extract(r'<style>(.*?)</style>', 'css', 'text/css', '<link rel="stylesheet" href="{}">')
+    extract(r'<script>(.*?)</script>', 'js', 'application/javascript', '<script src="{}"></script>')
+    return html, files
+
+
+def build_assets(page, split, encodings):
+    """The files the firmware serves: [{name, path, type, cache, variants}, ...]."""
+    if not split:
+        return [{'name': 'DASHBOARD_HTML', 'path': '/', 'type': 'text/html', 'cache': 'no-cache',
+                 'variants': compress(page, encodings)}]
+    shell, files = split_page(page.decode('utf-8'))
+    assets = [{'name': 'DASHBOARD_SHELL', 'path': '/', 'type': 'text/html', 'cache': 'no-cache',
+               'variants': compress(shell.encode('utf-8'), encodings)}]
+    for name, content_type, data in files:
+        assets.append({'name': 'DASHBOARD_' + name.rsplit('.', 1)[1].upper(), 'path': '/' + name,
+                       'type': content_type, 'cache': IMMUTABLE, 'variants': compress(data, encodings)})
+    return assets
+
+
+def c_assets(assets, bytes_to_c_array):
+    """PROGMEM arrays, the DASHBOARD_ASSETS table and the begin() argument macros."""
+    suffix = {'gzip': '', 'br': '_BR'}
+    out = []
+    rows = []
+    for asset in assets:
+        name = asset['name']
+        out.append(f'// {asset["path"]} ({asset["type"]})')
+        for encoding, data in asset['variants'].items():
+            array = name + suffix[encoding]
+            out.append(f'''#define {array}_SIZE {len(data)}
+const uint8_t {array}_DATA[{len(data)}] PROGMEM = {{
+{bytes_to_c_array(data)}
+}};
+''')
+        cells = []
+        for encoding in ENCODINGS:
+            array = name + suffix[encoding]
+            cells.append(f'{array}_DATA, {array}_SIZE' if encoding in asset['variants'] else 'nullptr, 0')
+        cells = ', '.join(cells)
+        rows.append(f'    {{"{asset["path"]}", "{asset["type"]}", "{asset["cache"]}",\n     {cells}}}')
+
+    if len(assets) == 1:
+        # Unsplit page: the begin() overload that takes the variants directly
+        out.append(f'''// Every variant that was built, for ESPDashboardPlus::begin():
+//   dashboard.begin(&server, DASHBOARD_HTML_VARIANTS);
+#define DASHBOARD_HTML_VARIANTS {cells}
+''')
+    rows_text = ',\n'.join(rows)
+    out.append(f'''// Files to serve, registered by ESPDashboardPlus::begin():
+//   dashboard.begin(&server, DASHBOARD_ASSETS, DASHBOARD_ASSET_COUNT);
+// (include this header after ESPDashboardPlus.h)
+#define DASHBOARD_ASSET_COUNT {len(assets)}
+#ifdef ESP_DASHBOARD_PLUS_H
+const DashboardAsset DASHBOARD_ASSETS[DASHBOARD_ASSET_COUNT] = {{
+{rows_text}
+}};
+#endif
+''')
+    return '\n'.join(out)
+
+
+# Extension of each stored variant on the filesystem
+FS_SUFFIX = {'gzip': '.gz', 'br': '.br'}
+
+
+def fs_name(path):
+    """File name of an asset in the UI directory: "/" is index.html."""
+    return 'index.html' if path == '/' else path.lstrip('/')
+
+
+def write_fs(assets, directory):
+    """Write the compressed assets as <name>.gz / <name>.br into directory, for
+    begin(&server, LittleFS, dir, ...), each with a <file>.etag holding a hash of
+    its content, and delete UI files of earlier builds. Returns the names written."""
+    os.makedirs(directory, exist_ok=True)
+    written = []
+    for asset in assets:
+        for encoding, data in asset['variants'].items():
+            name = fs_name(asset['path']) + FS_SUFFIX[encoding]
+            with open(os.path.join(directory, name), 'wb') as f:
+                f.write(data)
+            with open(os.path.join(directory, name + '.etag'), 'w') as f:
+                f.write(hashlib.md5(data).hexdigest()[:8])
+            written += [name, name + '.etag']
+    for name in os.listdir(directory):
+        stale = name.startswith('index.html') or re.match(r'app\.[0-9a-f]{8}\.(css|js)', name)
+        if stale and name not in written:
+            os.remove(os.path.join(directory, name))
+    return written
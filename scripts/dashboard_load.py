@@ -0,0 +1,416 @@
+#!/usr/bin/env python3
+"""
+Multi-client WebSocket load generator for ESP Dashboard
+
+Opens N WebSocket clients against a device or the host server
+(extras/native/serve.cpp) and runs one scenario while measuring delivered
+update rate, action latency percentiles, disconnects and the server's free
+heap over time (polled from /metrics.json).
+
+Scenarios:
+    connect-storm   All clients connect at once, request the init snapshot and
+                    reconnect as soon as it arrives; measures connect-to-init time
+    slider-flood    Every client drags a slider: change actions at --rate per second
+    steady          Clients only watch; measures update rate and inter-arrival gaps
+    ota             One client uploads --firmware as the OTA tab does while the
+                    others watch. On a device this FLASHES THE FIRMWARE.
+
+Action latency comes from the "ack" frames the dashboard sends when
+setActionTracing(true) is on (the host server enables it); without them only
+rates are reported.
+
+Usage:
+    pio run -e native-serve -t exec &
+    python scripts/dashboard_load.py localhost --port 8080 --clients 20 --scenario slider-flood
+    python scripts/dashboard_load.py 192.168.1.50 --clients 8 --scenario steady --duration 60 --json out.json
+
+Only the Python standard library is used.
+"""
+
+import argparse
+import asyncio
+import base64
+import json
+import os
+import struct
+import sys
+import time
+import urllib.request
+
+
+# ---------------------------------------------------------------------------
+# Minimal WebSocket client (RFC 6455, text frames only)
+# ---------------------------------------------------------------------------
+
+class WebSocket:
+    def __init__(self, reader, writer):
+        self.reader = reader
+        self.writer = writer
+
+    @classmethod
+    async def connect(cls, host, port, path):
+        reader, writer = await asyncio.open_connection(host, port)
+        key = base64.b64encode(os.urandom(16)).decode()
+        writer.write((f"GET {path} HTTP/1.1\r\nHost: {host}:{port}\r\nUpgrade: websocket\r\n"
+                      f"Connection: Upgrade\r\nSec-WebSocket-Key: {key}\r\n"
+                      f"Sec-WebSocket-Version: 13\r\n\r\n").encode())
+        head = await reader.readuntil(b"\r\n\r\n")
+        if b" 101 " not in head.split(b"\r\n", 1)[0]:
+            writer.close()
+            raise ConnectionError(head.split(b"\r\n", 1)[0].decode(errors='replace'))
+        return cls(reader, writer)
+
+    async def send(self, text):
+        payload = text.encode()
+        mask = os.urandom(4)
+        length = len(payload)
+        if length < 126:
+            header = struct.pack('!BB', 0x81, 0x80 | length)
+        elif length < 65536:
+            header = struct.pack('!BBH', 0x81, 0x80 | 126, length)
+        else:
+            header = struct.pack('!BBQ', 0x81, 0x80 | 127, length)
+        masked = bytes(b ^ mask[i % 4] for i, b in enumerate(payload))
+        self.writer.write(header + mask + masked)
+        await self.writer.drain()
+
+    async def recv(self):
+        """Next complete text or binary message; raises ConnectionError on close."""
+        message = b''
+        while True:
+            b0, b1 = await self.reader.readexactly(2)
+            length = b1 & 0x7F
+            if length == 126:
+                length, = struct.unpack('!H', await self.reader.readexactly(2))
+            elif length == 127:
+                length, = struct.unpack('!Q', await self.reader.readexactly(8))
+            payload = await self.reader.readexactly(length)
+            opcode = b0 & 0x0F
+            if opcode == 0x8:
+                raise ConnectionError('closed by server')
+            if opcode == 0x9:
+                self.writer.write(struct.pack('!BB', 0x8A, 0x80 | len(payload)) + b'\0\0\0\0' + payload)
+                continue
+            if opcode in (0x0, 0x1, 0x2):
+                message += payload
+                if b0 & 0x80:
+                    return message
+
+    def close(self):
+        self.writer.close()
+
+
+# ---------------------------------------------------------------------------
+# Measurements
+# ---------------------------------------------------------------------------
+
+class Stats:
+    def __init__(self):
+        self.updates = 0
+        self.messages = 0
+        self.bytes = 0
+        self.actions = 0
+        self.latencies = []       # Action -> ack, ms
+        self.gaps = []            # Between consecutive updates on one client, ms
+        self.connect_times = []   # Connect -> init snapshot, ms
+        self.disconnects = 0
+        self.connect_errors = 0
+        self.heap = []            # (seconds since start, free heap bytes)
+        self.queues = []          # (seconds since start, longest client queue)
+
+
+def percentile(values, p):
+    if not values:
+        return None
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(len(ordered) * p / 100))]
+
+
+def summary(values):
+    return {
+        'count': len(values),
+        'p50': percentile(values, 50),
+        'p90': percentile(values, 90),
+        'p99': percentile(values, 99),
+        'max': max(values) if values else None,
+    }
+
+
+# ---------------------------------------------------------------------------
+# Clients
+# ---------------------------------------------------------------------------
+
+class Client:
+    """One viewer: connects, requests the snapshot and counts what it receives."""
+
+    def __init__(self, index, args, stats):
+        self.index = index
+        self.args = args
+        self.stats = stats
+        self.ws = None
+        self.pending = {}   # traceId -> send time
+        self.next_trace = index * 1000000 + 1
+        self.last_update = None
+        self.init_event = asyncio.Event()
+
+    async def open(self):
+        started = time.monotonic()
+        self.init_event.clear()
+        self.ws = await WebSocket.connect(self.args.host, self.args.port, self.args.path)
+        await self.ws.send('{"type":"init"}')
+        return started
+
+    async def receive(self):
+        try:
+            while True:
+                data = await self.ws.recv()
+                now = time.monotonic()
+                self.stats.messages += 1
+                self.stats.bytes += len(data)
+                try:
+                    msg = json.loads(data)
+                except ValueError:
+                    continue
+                kind = msg.get('type')
+                if kind == 'init':
+                    self.init_event.set()
+                elif kind == 'update':
+                    self.stats.updates += 1
+                    if self.last_update is not None:
+                        self.stats.gaps.append((now - self.last_update) * 1000)
+                    self.last_update = now
+                elif kind == 'ack':
+                    sent = self.pending.pop(msg.get('traceId'), None)
+                    if sent is not None:
+                        self.stats.latencies.append((now - sent) * 1000)
+        except (ConnectionError, asyncio.IncompleteReadError, OSError):
+            self.stats.disconnects += 1
+
+    async def action(self, card, action, data):
+        trace = self.next_trace
+        self.next_trace += 1
+        self.pending[trace] = time.monotonic()
+        if len(self.pending) > 1000:
+            self.pending.pop(next(iter(self.pending)))  # Never acked (queue full or tracing off)
+        self.stats.actions += 1
+        await self.ws.send(json.dumps({'type': 'action', 'cardId': card, 'action': action,
+                                       'data': data, 'traceId': trace,
+                                       't': int(time.monotonic() * 1000) & 0xFFFFFFFF}))
+
+
+async def watch(client, deadline):
+    """Connect and receive until the deadline."""
+    try:
+        await client.open()
+    except (ConnectionError, OSError):
+        client.stats.connect_errors += 1
+        return
+    receiver = asyncio.ensure_future(client.receive())
+    await asyncio.wait([receiver], timeout=max(0, deadline - time.monotonic()))
+    receiver.cancel()
+    client.ws.close()
+
+
+async def scenario_connect_storm(clients, args, deadline):
+    async def storm(client):
+        while time.monotonic() < deadline:
+            try:
+                started = await client.open()
+            except (ConnectionError, OSError):
+                client.stats.connect_errors += 1
+                await asyncio.sleep(0.1)
+                continue
+            receiver = asyncio.ensure_future(client.receive())
+            try:
+                await asyncio.wait_for(client.init_event.wait(), timeout=10)
+                client.stats.connect_times.append((time.monotonic() - started) * 1000)
+            except asyncio.TimeoutError:
+                pass
+            receiver.cancel()
+            client.ws.close()
+    await asyncio.gather(*(storm(c) for c in clients))
+
+
+async def scenario_slider_flood(clients, args, deadline):
+    async def drag(client):
+        try:
+            await client.open()
+        except (ConnectionError, OSError):
+            client.stats.connect_errors += 1
+            return
+        receiver = asyncio.ensure_future(client.receive())
+        try:
+            await asyncio.wait_for(client.init_event.wait(), timeout=10)
+        except asyncio.TimeoutError:
+            pass  # Drag anyway; the snapshot only matters to a real page
+        value = 0
+        interval = 1.0 / args.rate
+        while time.monotonic() < deadline and not receiver.done():
+            value = (value + 7) % 256
+            try:
+                await client.action(args.card, 'change', {'value': value})
+            except (ConnectionError, OSError):
+                break
+            await asyncio.sleep(interval)
+        receiver.cancel()
+        client.ws.close()
+    await asyncio.gather(*(drag(c) for c in clients))
+
+
+async def scenario_steady(clients, args, deadline):
+    await asyncio.gather(*(watch(c, deadline) for c in clients))
+
+
+async def scenario_ota(clients, args, deadline):
+    with open(args.firmware, 'rb') as f:
+        firmware = f.read()
+    uploader, viewers = clients[0], clients[1:]
+
+    async def upload():
+        try:
+            await uploader.open()
+        except (ConnectionError, OSError):
+            uploader.stats.connect_errors += 1
+            return
+        receiver = asyncio.ensure_future(uploader.receive())
+        started = time.monotonic()
+        # Same framing and pacing as the OTA tab of the page
+        await uploader.ws.send(json.dumps({'type': 'ota_start', 'name': os.path.basename(args.firmware),
+                                           'size': len(firmware)}))
+        for offset in range(0, len(firmware), 2048):
+            chunk = base64.b64encode(firmware[offset:offset + 2048]).decode()
+            await uploader.ws.send(json.dumps({'type': 'ota_chunk', 'data': chunk}))
+            await asyncio.sleep(0.02)
+        await uploader.ws.send('{"type":"ota_end"}')
+        elapsed = time.monotonic() - started
+        print(f"OTA: {len(firmware)} bytes in {elapsed:.1f} s ({len(firmware) / elapsed / 1024:.1f} KB/s)")
+        await asyncio.sleep(1)
+        receiver.cancel()
+        uploader.ws.close()
+
+    await asyncio.gather(upload(), *(watch(c, deadline) for c in viewers))
+
+
+SCENARIOS = {
+    'connect-storm': scenario_connect_storm,
+    'slider-flood': scenario_slider_flood,
+    'steady': scenario_steady,
+    'ota': scenario_ota,
+}
+
+
+# ---------------------------------------------------------------------------
+# Server side
+# ---------------------------------------------------------------------------
+
+async def poll_metrics(args, stats, started, deadline):
+    """Free heap and the longest client queue from /metrics.json, once per second."""
+    url = f"http://{args.host}:{args.port}/metrics.json"
+    loop = asyncio.get_event_loop()
+
+    def fetch():
+        with urllib.request.urlopen(url, timeout=2) as response:
+            return json.loads(response.read())
+
+    while time.monotonic() < deadline:
+        try:
+            metrics = await loop.run_in_executor(None, fetch)
+            now = round(time.monotonic() - started, 1)
+            stats.heap.append((now, metrics.get('heap', {}).get('free')))
+            queues = [c.get('queue', 0) for c in metrics.get('clients', [])]
+            stats.queues.append((now, max(queues) if queues else 0))
+        except (OSError, ValueError):
+            pass  # Metrics disabled (DASHBOARD_METRICS=0) or device busy
+        await asyncio.sleep(1)
+
+
+async def run(args):
+    stats = Stats()
+    clients = [Client(i, args, stats) for i in range(args.clients)]
+    started = time.monotonic()
+    deadline = started + args.duration
+    poller = asyncio.ensure_future(poll_metrics(args, stats, started, deadline))
+    await SCENARIOS[args.scenario](clients, args, deadline)
+    poller.cancel()
+    return stats, time.monotonic() - started
+
+
+def report(args, stats, elapsed):
+    heap = [h for _, h in stats.heap if h is not None]
+    result = {
+        'scenario': args.scenario,
+        'clients': args.clients,
+        'seconds': round(elapsed, 1),
+        'updates_per_second': round(stats.updates / elapsed, 1),
+        'updates_per_client_per_second': round(stats.updates / elapsed / max(1, args.clients), 2),
+        'messages': stats.messages,
+        'bytes_received': stats.bytes,
+        'actions_sent': stats.actions,
+        'action_latency_ms': summary(stats.latencies),
+        'update_gap_ms': summary(stats.gaps),
+        'connect_to_init_ms': summary(stats.connect_times),
+        'disconnects': stats.disconnects,
+        'connect_errors': stats.connect_errors,
+        'heap_free_min': min(heap) if heap else None,
+        'heap_free_last': heap[-1] if heap else None,
+        'heap_timeline': stats.heap,
+        'queue_timeline': stats.queues,
+    }
+
+    def ms(s):
+        if not s['count']:
+            return 'n/a'
+        return f"p50 {s['p50']:.1f}  p90 {s['p90']:.1f}  p99 {s['p99']:.1f}  max {s['max']:.1f} ms  ({s['count']})"
+
+    print(f"scenario          {args.scenario}, {args.clients} clients, {elapsed:.1f} s")
+    print(f"updates           {result['updates_per_second']}/s total, "
+          f"{result['updates_per_client_per_second']}/s per client")
+    print(f"received          {stats.messages} messages, {stats.bytes / 1024:.1f} KB")
+    if stats.actions:
+        acked = len(stats.latencies)
+        print(f"actions           {stats.actions} sent, {acked} acked")
+        print(f"action latency    {ms(result['action_latency_ms'])}")
+        if not acked:
+            print("                  (no acks: call setActionTracing(true) on the device)")
+    print(f"update gap        {ms(result['update_gap_ms'])}")
+    if stats.connect_times:
+        print(f"connect -> init   {ms(result['connect_to_init_ms'])}")
+    print(f"disconnects       {stats.disconnects} ({stats.connect_errors} failed connects)")
+    if heap:
+        print(f"free heap         min {min(heap)}  last {heap[-1]} bytes")
+    if stats.queues:
+        print(f"longest queue     {max(q for _, q in stats.queues)} messages")
+
+    if args.json:
+        with open(args.json, 'w', encoding='utf-8') as f:
+            json.dump(result, f, indent=2)
+        print(f"written to {args.json}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description='WebSocket load generator for ESP Dashboard')
+    parser.add_argument('host', help='Device address or localhost for the host server')
+    parser.add_argument('--port', type=int, default=80, help='HTTP port (default: 80)')
+    parser.add_argument('--path', default='/ws', help='WebSocket path (default: /ws)')
+    parser.add_argument('--clients', type=int, default=10, help='Concurrent clients (default: 10)')
+    parser.add_argument('--scenario', choices=sorted(SCENARIOS), default='steady')
+    parser.add_argument('--duration', type=float, default=30, help='Seconds to run (default: 30)')
+    parser.add_argument('--rate', type=float, default=20,
+                        help='slider-flood: actions per second per client (default: 20)')
+    parser.add_argument('--card', default='level', help='slider-flood: slider card id (default: level)')
+    parser.add_argument('--firmware', help='ota: firmware image to upload')
+    parser.add_argument('--json', help='Also write the results to this file')
+    args = parser.parse_args()
+
+    if args.scenario == 'ota' and not args.firmware:
+        parser.error('--scenario ota needs --firmware (the device flashes it)')
+    if args.clients < 1 or args.rate <= 0:
+        parser.error('--clients and --rate must be positive')
+
+    stats, elapsed = asyncio.run(run(args))
+    report(args, stats, elapsed)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
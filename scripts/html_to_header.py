@@ -2,16 +2,25 @@
 """
 ESP Dashboard - HTML to C++ Header Converter
 
-Standalone script to convert dashboard.html to a gzip-compressed
+Standalone script to convert dashboard.html to a gzip- and Brotli-compressed
 C++ header file that can be stored in PROGMEM on ESP32/ESP8266 devices.
 
 Usage:
-    python html_to_header.py [input_file] [output_file]
+    python html_to_header.py [input_file] [output_file] [--cards LIST] [--no-minify] [--encoding LIST] [--split] [--fs-dir DIR]
     
     Default paths (relative to library root):
         Input:  extras/dashboard.html
         Output: src/dashboard_html.h
 
+    --cards stat,gauge,ota  keep only these card types (see dashboard_build.py)
+    --no-minify             keep comments and whitespace
+    --encoding gzip         variants to store: gzip, br or both (default;
+                            br needs 'pip install brotli')
+    --split                 serve CSS and JS as content-hashed app.<hash>.css/.js
+                            files behind a small HTML shell
+    --fs-dir data/www       also write the compressed files there for a
+                            filesystem image (begin() with LittleFS)
+
 The generated header file includes:
 - Gzip-compressed HTML data stored in PROGMEM
 - Size constants for the compressed and uncompressed data
@@ -22,9 +31,12 @@ import sys
 import gzip
 import os
 import hashlib
+import argparse
 from datetime import datetime
 from pathlib import Path
 
+import dashboard_build
+
 def get_lib_root():
     """Get the library root directory (parent of scripts/)."""
     script_dir = Path(__file__).parent.absolute()
@@ -43,26 +55,59 @@ def bytes_to_c_array(data: bytes, bytes_per_line: int = 16) -> str:
         lines.append(f'    {hex_values}')
     return ',\n'.join(lines)
 
-def generate_header(html_path: str, output_path: str) -> None:
+def generate_header(html_path: str, output_path: str, cards=None, minify: bool = True,
+                    encodings=dashboard_build.ENCODINGS, split: bool = False, fs_dir: str = '') -> None:
     """Generate the C++ header file from HTML."""
     
     # Read HTML file
     with open(html_path, 'rb') as f:
         html_content = f.read()
     
-    original_size = len(html_content)
+    source_size = len(html_content)
+    source = html_content.decode('utf-8')
+    
+    if cards:
+        unknown = cards - dashboard_build.card_types(source)
+        if unknown:
+            print(f"Warning: unknown card types: {', '.join(sorted(unknown))}")
     
-    # Compress
-    compressed = compress_html(html_content)
-    compressed_size = len(compressed)
+    # Strip unused card types and minify
+    page = dashboard_build.build_page(source, cards, minify)
+    original_size = len(page)
+    
+    # Split into files and compress
+    assets = dashboard_build.build_assets(page, split, list(encodings))
+    totals = {e: sum(len(a['variants'][e]) for a in assets) for e in assets[0]['variants']}
+    compressed_size = min(totals.values())
+    source_compressed_size = len(compress_html(html_content))
     
     compression_ratio = (1 - compressed_size / original_size) * 100
+    sizes_text = ', '.join(f"{e} {size:,} bytes" for e, size in totals.items())
+    files_text = ', '.join(a['path'] for a in assets)
     
     # Content hash for versioning
-    content_hash = hashlib.md5(html_content).hexdigest()[:8]
+    content_hash = hashlib.md5(page).hexdigest()[:8]
+    cards_text = ', '.join(sorted(cards)) if cards else 'all'
     
-    # Generate C array
-    c_array = bytes_to_c_array(compressed)
+    # Helper for projects that serve the page themselves (unsplit gzip variant)
+    helper = '''
+/**
+ * Helper function to serve the dashboard HTML
+ * Can be used directly with AsyncWebServer
+ * 
+ * Example:
+ *   server.on("/", HTTP_GET, serveDashboardHTML);
+ */
+#ifdef ESP_ASYNC_WEBSERVER_H
+inline void serveDashboardHTML(AsyncWebServerRequest *request) {
+    AsyncWebServerResponse *response = request->beginResponse_P(
+        200, "text/html", DASHBOARD_HTML_DATA, DASHBOARD_HTML_SIZE);
+    response->addHeader("Content-Encoding", "gzip");
+    response->addHeader("Cache-Control", "max-age=86400");
+    request->send(response);
+}
+#endif
+''' if not split and 'gzip' in totals else ''
     
     # Generate header content
     header_content = f'''/**
@@ -74,9 +119,12 @@ def generate_header(html_path: str, output_path: str) -> None:
  * Generated: {datetime.now().strftime('%Y-%m-%d %H:%M:%S')}
  * Content hash: {content_hash}
  * 
- * Source: {os.path.basename(html_path)}
+ * Source: {os.path.basename(html_path)} ({source_size:,} bytes)
+ * Card types: {cards_text}
+ * Minified: {'yes' if minify else 'no'}
+ * Files: {files_text}
  * Original size: {original_size:,} bytes
- * Compressed size: {compressed_size:,} bytes
+ * Compressed size: {sizes_text}
  * Compression ratio: {compression_ratio:.1f}%
  * 
  * ESP Dashboard Library
@@ -90,32 +138,10 @@ def generate_header(html_path: str, output_path: str) -> None:
 #include <pgmspace.h>
 
 // Size constants
-#define DASHBOARD_HTML_SIZE {compressed_size}
 #define DASHBOARD_HTML_ORIGINAL_SIZE {original_size}
 #define DASHBOARD_HTML_HASH "{content_hash}"
 
-// Compressed HTML data in PROGMEM
-const uint8_t DASHBOARD_HTML_DATA[{compressed_size}] PROGMEM = {{
-{c_array}
-}};
-
-/**
- * Helper function to serve the dashboard HTML
- * Can be used directly with AsyncWebServer
- * 
- * Example:
- *   server.on("/", HTTP_GET, serveDashboardHTML);
- */
-#ifdef ESP_ASYNC_WEBSERVER_H
-inline void serveDashboardHTML(AsyncWebServerRequest *request) {{
-    AsyncWebServerResponse *response = request->beginResponse_P(
-        200, "text/html", DASHBOARD_HTML_DATA, DASHBOARD_HTML_SIZE);
-    response->addHeader("Content-Encoding", "gzip");
-    response->addHeader("Cache-Control", "max-age=86400");
-    request->send(response);
-}}
-#endif
-
+{dashboard_build.c_assets(assets, bytes_to_c_array)}{helper}
 #endif // DASHBOARD_HTML_H
 '''
 
@@ -126,11 +152,21 @@ inline void serveDashboardHTML(AsyncWebServerRequest *request) {{
     with open(output_path, 'w', encoding='utf-8') as f:
         f.write(header_content)
     
-    print(f"✓ Generated: {output_path}")
-    print(f"  Original size:   {original_size:>8,} bytes")
-    print(f"  Compressed size: {compressed_size:>8,} bytes")
+    print(f"✓ Generated: {output_path} (card types: {cards_text})")
+    print(f"  Source size:     {source_size:>8,} bytes ({source_compressed_size:,} gzipped)")
+    print(f"  Built size:      {original_size:>8,} bytes")
+    for encoding, size in totals.items():
+        print(f"  {encoding + ' size:':<17}{size:>8,} bytes")
+    if split:
+        for asset in assets:
+            sizes = ', '.join(f"{e} {len(v):,}" for e, v in asset['variants'].items())
+            print(f"    {asset['path']:<22} {sizes}")
     print(f"  Compression:     {compression_ratio:>7.1f}%")
-    print(f"  Savings:         {original_size - compressed_size:>8,} bytes")
+    print(f"  Savings:         {source_compressed_size - compressed_size:>8,} bytes of flash vs. the unprocessed page")
+    
+    if fs_dir:
+        written = dashboard_build.write_fs(assets, fs_dir)
+        print(f"✓ Wrote {', '.join(written)} to {fs_dir}")
 
 def main():
     lib_root = get_lib_root()
@@ -140,15 +176,17 @@ def main():
     default_output = lib_root / 'src' / 'dashboard_html.h'
     
     # Parse command line arguments
-    if len(sys.argv) >= 3:
-        input_file = sys.argv[1]
-        output_file = sys.argv[2]
-    elif len(sys.argv) == 2:
-        input_file = sys.argv[1]
-        output_file = str(default_output)
-    else:
-        input_file = str(default_input)
-        output_file = str(default_output)
+    parser = argparse.ArgumentParser(description='Convert dashboard.html to a PROGMEM header')
+    parser.add_argument('input_file', nargs='?', default=str(default_input))
+    parser.add_argument('output_file', nargs='?', default=str(default_output))
+    parser.add_argument('--cards', default='', help='Comma-separated card types to keep (default: all)')
+    parser.add_argument('--no-minify', action='store_true', help='Keep comments and whitespace')
+    parser.add_argument('--encoding', default='', help='Compressed variants: gzip, br or both (default)')
+    parser.add_argument('--split', action='store_true', help='Serve CSS and JS as separate content-hashed files')
+    parser.add_argument('--fs-dir', default='', help='Also write the compressed files to this directory')
+    args = parser.parse_args()
+    input_file = args.input_file
+    output_file = args.output_file
     
     # Check input file exists
     if not os.path.exists(input_file):
@@ -163,7 +201,8 @@ def main():
     print(f"       to {output_file}")
     print()
     
-    generate_header(input_file, output_file)
+    generate_header(input_file, output_file, dashboard_build.parse_cards(args.cards), not args.no_minify,
+                    dashboard_build.parse_encodings(args.encoding), args.split, args.fs_dir)
     print("\nDone! Include the header file in your ESP32 project.")
 
 if __name__ == '__main__':
@@ -3,8 +3,10 @@
 PlatformIO Pre-Build Script for ESP Dashboard
 
 This script is automatically executed by PlatformIO before each build.
-It converts the dashboard.html file into a gzip-compressed C++ header
-file that can be stored in PROGMEM.
+It converts the dashboard.html file into a gzip- and Brotli-compressed C++
+header file that can be stored in PROGMEM. The page is minified first and, if the
+project lists the card types it uses, stripped of everything the other types
+need (see scripts/dashboard_build.py).
 
 Library Structure:
     ESP-DashboardPlus/
@@ -14,18 +16,40 @@ Library Structure:
     ├── extras/
     │   └── dashboard.html        <- Input HTML
     └── scripts/
+        ├── dashboard_build.py    <- Card stripping and minification
         └── html_to_header_pio.py <- This script
 
 Usage (automatic via platformio.ini):
     extra_scripts = pre:scripts/html_to_header_pio.py
 
+Options (platformio.ini, per environment):
+    custom_dashboard_cards = stat, gauge, chart, toggle, ota
+        Card types the project uses; all others are stripped from the page.
+        "ota" keeps the firmware update tab, "action" the confirm dialog.
+        Default: all types.
+    custom_dashboard_minify = no
+        Serve the page as written (for debugging in the browser).
+    custom_dashboard_encoding = gzip
+        Compressed variants to store: gzip, br or both (default). Brotli
+        needs 'pip install brotli' in PlatformIO's Python; without it only
+        gzip is built. Browsers offer br over HTTPS only, so a br-only page
+        is for HTTPS or known clients.
+    custom_dashboard_split = yes
+        Serve CSS and JS as content-hashed app.<hash>.css/.js that browsers
+        cache for good, plus a small HTML shell. Use
+        begin(&server, DASHBOARD_ASSETS, DASHBOARD_ASSET_COUNT).
+    custom_dashboard_fs_dir = data/www
+        Also write the compressed files (index.html.gz, ...) into this
+        project directory for the filesystem image, so a UI change only
+        needs 'pio run -t uploadfs'. Serve them with
+        begin(&server, LittleFS, "/www", DASHBOARD_ASSETS, DASHBOARD_ASSET_COUNT).
+
 Manual usage:
     python scripts/html_to_header_pio.py
 """
 
 import os
 import sys
-import gzip
 import hashlib
 from datetime import datetime
 from pathlib import Path
@@ -55,12 +79,24 @@ def calculate_hash(content):
     """Calculate MD5 hash of content."""
     return hashlib.md5(content).hexdigest()
 
-def should_regenerate(html_path, hash_path, header_path):
+def build_key(html_content, options):
+    """Hash of everything the generated header depends on."""
+    cards = options['cards']
+    key = (f"|cards={','.join(sorted(cards)) if cards else '*'}|minify={int(options['minify'])}"
+           f"|encoding={','.join(options['encodings'])}|brotli={int(bool(dashboard_build.brotli))}"
+           f"|split={int(options['split'])}|fs={options['fs_dir']}")
+    return calculate_hash(html_content + key.encode('utf-8'))
+
+def should_regenerate(html_path, hash_path, header_path, fs_path, options):
     """Check if we need to regenerate the header file."""
     # Always regenerate if header doesn't exist
     if not os.path.exists(header_path):
         return True
     
+    # Or if the filesystem copy was asked for but has been deleted
+    if fs_path and not any(os.path.exists(fs_path / f'index.html{s}') for s in dashboard_build.FS_SUFFIX.values()):
+        return True
+    
     # Check if HTML file exists
     if not os.path.exists(html_path):
         print(f"[ESP-DashboardPlus] Warning: {html_path} not found")
@@ -69,7 +105,7 @@ def should_regenerate(html_path, hash_path, header_path):
     # Read current HTML content
     with open(html_path, 'rb') as f:
         current_content = f.read()
-    current_hash = calculate_hash(current_content)
+    current_hash = build_key(current_content, options)
     
     # Check stored hash
     if os.path.exists(hash_path):
@@ -80,10 +116,6 @@ def should_regenerate(html_path, hash_path, header_path):
     
     return True
 
-def compress_html(html_content):
-    """Compress HTML content using gzip with maximum compression."""
-    return gzip.compress(html_content, compresslevel=9)
-
 def bytes_to_c_array(data, bytes_per_line=16):
     """Convert bytes to C-style array format."""
     lines = []
@@ -93,7 +125,7 @@ def bytes_to_c_array(data, bytes_per_line=16):
         lines.append(f'    {hex_values}')
     return ',\n'.join(lines)
 
-def generate_header(html_path, header_path, hash_path):
+def generate_header(html_path, header_path, hash_path, fs_path, options):
     """Generate the C++ header file from HTML."""
     print(f"[ESP-DashboardPlus] Converting extras/dashboard.html to src/dashboard_html.h...")
     
@@ -101,19 +133,32 @@ def generate_header(html_path, header_path, hash_path):
     with open(html_path, 'rb') as f:
         html_content = f.read()
     
-    original_size = len(html_content)
+    source_size = len(html_content)
+    source = html_content.decode('utf-8')
+    cards, minify = options['cards'], options['minify']
     
-    # Compress
-    compressed = compress_html(html_content)
-    compressed_size = len(compressed)
+    if cards:
+        unknown = cards - dashboard_build.card_types(source)
+        if unknown:
+            print(f"[ESP-DashboardPlus] Warning: unknown card types in custom_dashboard_cards: {', '.join(sorted(unknown))}")
     
-    compression_ratio = (1 - compressed_size / original_size) * 100
+    # Strip unused card types and minify
+    page = dashboard_build.build_page(source, cards, minify)
+    original_size = len(page)
+    
+    # Split into shell and bundles if asked, then compress
+    assets = dashboard_build.build_assets(page, options['split'], options['encodings'])
+    encodings = list(assets[0]['variants'])
+    totals = {e: sum(len(a['variants'][e]) for a in assets) for e in encodings}
+    source_variants = dashboard_build.compress(html_content, encodings)
+    compressed_size = min(totals.values())
     
-    # Generate C array
-    c_array = bytes_to_c_array(compressed)
+    compression_ratio = (1 - compressed_size / original_size) * 100
+    sizes_text = ', '.join(f"{e} {size:,} bytes" for e, size in totals.items())
     
     # Content hash for versioning
-    content_hash = calculate_hash(html_content)[:8]
+    content_hash = calculate_hash(page)[:8]
+    cards_text = ', '.join(sorted(cards)) if cards else 'all'
     
     # Generate header content
     header_content = f'''/**
@@ -125,9 +170,12 @@ def generate_header(html_path, header_path, hash_path):
  * Generated: {datetime.now().strftime('%Y-%m-%d %H:%M:%S')}
  * Content hash: {content_hash}
  * 
- * Source: extras/dashboard.html
+ * Source: extras/dashboard.html ({source_size:,} bytes)
+ * Card types: {cards_text}
+ * Minified: {'yes' if minify else 'no'}
+ * Files: {', '.join(a['path'] for a in assets)}
  * Original size: {original_size:,} bytes
- * Compressed size: {compressed_size:,} bytes
+ * Compressed size: {sizes_text}
  * Compression ratio: {compression_ratio:.1f}%
  * 
  * ESP Dashboard Library
@@ -141,15 +189,10 @@ def generate_header(html_path, header_path, hash_path):
 #include <pgmspace.h>
 
 // Size constants
-#define DASHBOARD_HTML_SIZE {compressed_size}
 #define DASHBOARD_HTML_ORIGINAL_SIZE {original_size}
 #define DASHBOARD_HTML_HASH "{content_hash}"
 
-// Compressed HTML data in PROGMEM
-const uint8_t DASHBOARD_HTML_DATA[{compressed_size}] PROGMEM = {{
-{c_array}
-}};
-
+{dashboard_build.c_assets(assets, bytes_to_c_array)}
 #endif // DASHBOARD_HTML_H
 '''
 
@@ -160,14 +203,50 @@ const uint8_t DASHBOARD_HTML_DATA[{compressed_size}] PROGMEM = {{
     with open(header_path, 'w', encoding='utf-8') as f:
         f.write(header_content)
     
+    # Files for the filesystem image
+    if fs_path:
+        written = dashboard_build.write_fs(assets, fs_path)
+        print(f"[ESP-DashboardPlus] ✓ Wrote {len(written)} file(s) to {options['fs_dir']} (upload with 'pio run -t uploadfs')")
+    
     # Save hash
-    current_hash = calculate_hash(html_content)
+    current_hash = build_key(html_content, options)
     with open(hash_path, 'w') as f:
         f.write(current_hash)
     
-    print(f"[ESP-DashboardPlus] ✓ Generated src/dashboard_html.h")
-    print(f"[ESP-DashboardPlus]   Original:   {original_size:>8,} bytes")
-    print(f"[ESP-DashboardPlus]   Compressed: {compressed_size:>8,} bytes ({compression_ratio:.1f}% reduction)")
+    print(f"[ESP-DashboardPlus] ✓ Generated src/dashboard_html.h (card types: {cards_text})")
+    columns = ''.join(f"{e:>10}" for e in encodings)
+    print(f"[ESP-DashboardPlus]                  HTML{columns}")
+    cells = ''.join(f"{len(v):>10,}" for v in source_variants.values())
+    print(f"[ESP-DashboardPlus]   {'Source:':<9}{source_size:>10,}{cells} bytes")
+    cells = ''.join(f"{size:>10,}" for size in totals.values())
+    print(f"[ESP-DashboardPlus]   {'Built:':<9}{original_size:>10,}{cells} bytes")
+    saved = ''.join(f"{len(source_variants[e]) - totals[e]:>10,}" for e in encodings)
+    print(f"[ESP-DashboardPlus]   {'Saved:':<9}{source_size - original_size:>10,}{saved} bytes")
+    if len(assets) > 1:
+        for asset in assets:
+            cells = ''.join(f"{len(v):>10,}" for v in asset['variants'].values())
+            print(f"[ESP-DashboardPlus]     {asset['path']:<17}{cells} bytes")
+
+def get_build_options():
+    """Card manifest, minify and split switches, encodings and filesystem directory from
+    platformio.ini (defaults when standalone)."""
+    cards, minify, encoding, split, fs_dir = '', 'yes', '', 'no', ''
+    if 'env' in globals():
+        try:
+            cards = env.GetProjectOption('custom_dashboard_cards', '')
+            minify = env.GetProjectOption('custom_dashboard_minify', 'yes')
+            encoding = env.GetProjectOption('custom_dashboard_encoding', '')
+            split = env.GetProjectOption('custom_dashboard_split', 'no')
+            fs_dir = env.GetProjectOption('custom_dashboard_fs_dir', '')
+        except Exception:
+            pass
+    return {
+        'cards': dashboard_build.parse_cards(cards),
+        'minify': str(minify).strip().lower() not in ('no', 'false', '0', 'off'),
+        'encodings': dashboard_build.parse_encodings(encoding),
+        'split': str(split).strip().lower() in ('yes', 'true', '1', 'on'),
+        'fs_dir': str(fs_dir).strip(),
+    }
 
 def main():
     """Main entry point."""
@@ -217,10 +296,21 @@ def main():
     header_path = lib_root / 'src' / 'dashboard_html.h'
     hash_path = lib_root / 'src' / '.dashboard_hash'
 
+    # The build stages live next to this script in the library
+    global dashboard_build
+    for scripts_dir in (html_path.parent.parent / 'scripts', get_lib_root() / 'scripts'):
+        if (scripts_dir / 'dashboard_build.py').exists():
+            sys.path.insert(0, str(scripts_dir))
+            break
+    import dashboard_build
+
+    options = get_build_options()
+    fs_path = lib_root / options['fs_dir'] if options['fs_dir'] else None
+
     # Check if regeneration is needed
-    if should_regenerate(html_path, hash_path, header_path):
+    if should_regenerate(html_path, hash_path, header_path, fs_path, options):
         if html_path.exists():
-            generate_header(html_path, header_path, hash_path)
+            generate_header(html_path, header_path, hash_path, fs_path, options)
         else:
             print(f"[ESP-DashboardPlus] Warning: {html_path} not found, skipping header generation")
     else:
@@ -38,12 +38,153 @@
  #include <ArduinoJson.h>
  #include <ESPAsyncWebServer.h>
  #if defined(ARDUINO_ARCH_ESP32)
+ #include <FS.h>
+ #include <Update.h>
+ #include <esp_log.h>
+ #elif defined(DASHBOARD_NATIVE)
  #include <Update.h>
  #endif
+ #include <algorithm>
+ #include <atomic>
+ #include <cstdarg>
  #include <functional>
  #include <map>
+ #include <memory>
+ #include <new>
  #include <vector>
+ #if !defined(ARDUINO_ARCH_ESP8266)
+ #include <mutex>
+ #endif
  
+// ========================================
+// Build configuration (override with -D flags)
+// ========================================
+
+// Largest inbound WebSocket message accepted; bigger messages are dropped
+#ifndef DASHBOARD_WS_MAX_MESSAGE_SIZE
+#define DASHBOARD_WS_MAX_MESSAGE_SIZE 4096
+#endif
+
+// Answer pages that ask for it in their init message ({type:"init",protocol:"msgpack"})
+// with MessagePack binary frames; 0 keeps every outbound frame JSON text
+#ifndef DASHBOARD_MSGPACK
+#define DASHBOARD_MSGPACK 1
+#endif
+
+// Number of clients that can send fragmented messages at the same time
+#ifndef DASHBOARD_WS_REASSEMBLY_SLOTS
+#define DASHBOARD_WS_REASSEMBLY_SLOTS 2
+#endif
+
+// Deferred actions: queue depth (power of two) and per-record payload bytes
+#ifndef DASHBOARD_ACTION_QUEUE_SIZE
+#define DASHBOARD_ACTION_QUEUE_SIZE 16
+#endif
+
+#ifndef DASHBOARD_ACTION_PAYLOAD_SIZE
+#define DASHBOARD_ACTION_PAYLOAD_SIZE 192
+#endif
+
+// Published updates: queue depth (power of two) and inline text bytes per record
+#ifndef DASHBOARD_UPDATE_QUEUE_SIZE
+#define DASHBOARD_UPDATE_QUEUE_SIZE 32
+#endif
+
+#ifndef DASHBOARD_UPDATE_TEXT_SIZE
+#define DASHBOARD_UPDATE_TEXT_SIZE 24
+#endif
+
+// ConsoleCard log ring: bytes reserved per maxEntries slot, and longest stored message
+#ifndef DASHBOARD_CONSOLE_BYTES_PER_ENTRY
+#define DASHBOARD_CONSOLE_BYTES_PER_ENTRY 64
+#endif
+
+#ifndef DASHBOARD_CONSOLE_MAX_MESSAGE
+#define DASHBOARD_CONSOLE_MAX_MESSAGE 200
+#endif
+
+// Longest formatted logf() line (stack buffer)
+#ifndef DASHBOARD_LOG_LINE_SIZE
+#define DASHBOARD_LOG_LINE_SIZE 256
+#endif
+
+// Console log batch: bytes of JSON collected before a {type:"logs"} frame is sent
+#ifndef DASHBOARD_LOG_BATCH_SIZE
+#define DASHBOARD_LOG_BATCH_SIZE 2048
+#endif
+
+// Tags a single client can subscribe to in the console (0 tags = everything)
+#ifndef DASHBOARD_LOG_MAX_TAGS
+#define DASHBOARD_LOG_MAX_TAGS 8
+#endif
+
+// Lock-free ring that collects captured log lines (ESP-IDF logs, DashboardLogPrint,
+// captureLog()) until the dashboard drains them; bytes, power of two
+#ifndef DASHBOARD_LOG_CAPTURE_SIZE
+#define DASHBOARD_LOG_CAPTURE_SIZE 4096
+#endif
+
+// Longest captured line; longer lines are truncated
+#ifndef DASHBOARD_CAPTURE_LINE_SIZE
+#define DASHBOARD_CAPTURE_LINE_SIZE 160
+#endif
+
+// Persistent log store (enableLogStore): number of segment files, RAM buffer per
+// write batch (two are allocated), and the longest a line waits before being written
+#ifndef DASHBOARD_LOG_STORE_SEGMENTS
+#define DASHBOARD_LOG_STORE_SEGMENTS 4
+#endif
+#ifndef DASHBOARD_LOG_STORE_BUFFER
+#define DASHBOARD_LOG_STORE_BUFFER 2048
+#endif
+#ifndef DASHBOARD_LOG_STORE_FLUSH_MS
+#define DASHBOARD_LOG_STORE_FLUSH_MS 10000
+#endif
+
+// Traffic recorder (startRecording): RAM buffer per write batch (two are allocated)
+// and the longest argument data of one recorded update call
+#ifndef DASHBOARD_RECORDER_BUFFER
+#define DASHBOARD_RECORDER_BUFFER 8192
+#endif
+#ifndef DASHBOARD_RECORDER_ENTRY_SIZE
+#define DASHBOARD_RECORDER_ENTRY_SIZE 192
+#endif
+
+// Library metrics (message counters, latency histograms, /metrics endpoints).
+// Set to 0 to compile all instrumentation out.
+#ifndef DASHBOARD_METRICS
+#define DASHBOARD_METRICS 1
+#endif
+
+#if DASHBOARD_METRICS
+#define DASHBOARD_METRIC(...) __VA_ARGS__
+#else
+#define DASHBOARD_METRIC(...)
+#endif
+
+// Largest piece of /metrics output rendered at once (one metric group or one card)
+#ifndef DASHBOARD_METRICS_ITEM_SIZE
+#define DASHBOARD_METRICS_ITEM_SIZE 1536
+#endif
+
+// Number of closed windows the loop monitor summarizes (enableLoopMonitor)
+#ifndef DASHBOARD_LOOP_WINDOWS
+#define DASHBOARD_LOOP_WINDOWS 5
+#endif
+
+// OTA through the Update library: ESP32, and the host build (extras/native) so that
+// the upload path can be exercised without hardware
+#if defined(ARDUINO_ARCH_ESP32) || defined(DASHBOARD_NATIVE)
+#define DASHBOARD_OTA_UPDATE 1
+#else
+#define DASHBOARD_OTA_UPDATE 0
+#endif
+
+// Stack size of the optional dashboard task started by beginTask()
+#ifndef DASHBOARD_TASK_STACK_SIZE
+#define DASHBOARD_TASK_STACK_SIZE 8192
+#endif
+
  // Forward declarations
  class ESPDashboardPlus;
  class DashboardCard;
@@ -135,7 +276,665 @@ enum class CardType {
      String value;
      String label;
  };
- 
+
+// FNV-1a hash used to dispatch on message types and action names.
+// constexpr so that switch labels are folded at compile time.
+constexpr uint32_t dashboardHash(const char* s, uint32_t h = 2166136261u) {
+    return (s && *s) ? dashboardHash(s + 1, (h ^ (uint8_t)*s) * 16777619u) : h;
+}
+
+// The same hash over bytes in PROGMEM, e.g. for the ETag of an embedded page
+inline uint32_t dashboardHashBytes(const uint8_t* data, size_t len, uint32_t h = 2166136261u) {
+    for (size_t i = 0; i < len; i++) h = (h ^ pgm_read_byte(data + i)) * 16777619u;
+    return h;
+}
+
+/**
+ * One file of the web UI in PROGMEM, as listed in DASHBOARD_ASSETS of the
+ * generated dashboard_html.h. Either compressed variant may be absent.
+ */
+struct DashboardAsset {
+    const char* path;           // URL path, "/" for the page
+    const char* contentType;
+    const char* cacheControl;   // "no-cache" for the page, immutable for hashed bundles
+    const uint8_t* gzipData;
+    size_t gzipSize;
+    const uint8_t* brData;
+    size_t brSize;
+};
+
+/**
+ * One outbound WebSocket message, serialized once as JSON text or as a
+ * MessagePack binary frame and then sent to one or all clients. Frames up to
+ * 256 bytes are encoded on the stack.
+ */
+class DashboardFrame {
+public:
+    void encode(const JsonDocument& doc, bool msgpack) {
+        _binary = false;
+        _large.reset();
+        if (msgpack) {
+            _len = measureMsgPack(doc);
+            uint8_t* out = _small;
+            if (_len > sizeof(_small)) {
+                _large.reset(new (std::nothrow) uint8_t[_len]);
+                out = _large.get();
+            }
+            if (out) {
+                serializeMsgPack(doc, out, _len);
+                _binary = true;
+                return;
+            }
+        }
+        _text = String();
+        serializeJson(doc, _text);
+        _len = _text.length();
+    }
+    
+    size_t length() const { return _len; }
+    bool binary() const { return _binary; }
+    
+    void send(AsyncWebSocketClient* client) {
+        if (_binary) {
+            client->binary(data(), _len);
+        } else {
+            client->text(_text);
+        }
+    }
+    
+    void sendAll(AsyncWebSocket* ws) {
+        if (_binary) {
+            ws->binaryAll(data(), _len);
+        } else {
+            ws->textAll(_text);
+        }
+    }
+    
+private:
+    const uint8_t* data() const { return _large ? _large.get() : _small; }
+    
+    String _text;
+    uint8_t _small[256];
+    std::unique_ptr<uint8_t[]> _large;
+    size_t _len = 0;
+    bool _binary = false;
+};
+
+// Length of s[0..len) without a UTF-8 sequence left incomplete at the end by a cut;
+// a partial character would make browsers close the WebSocket (1007, invalid UTF-8)
+inline size_t dashboardUtf8Whole(const char* s, size_t len) {
+    size_t start = len;
+    while (start > 0 && len - start < 3 && ((uint8_t)s[start - 1] & 0xC0) == 0x80) start--;
+    if (start == 0) return len;
+    uint8_t lead = (uint8_t)s[start - 1];
+    size_t need = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+    return len - (start - 1) < need ? start - 1 : len;
+}
+
+// Length of s cut to at most max bytes on a UTF-8 character boundary
+inline size_t dashboardUtf8Cut(const char* s, size_t len, size_t max) {
+    return len <= max ? len : dashboardUtf8Whole(s, max);
+}
+
+// Base64 helpers for OTA chunks (operate on views into the parsed message)
+inline size_t dashboardBase64DecodedLength(const char* input, size_t len) {
+    size_t padding = 0;
+    if (len >= 2) {
+        if (input[len - 1] == '=') padding++;
+        if (input[len - 2] == '=') padding++;
+    }
+    return (len * 3 / 4) - padding;
+}
+
+inline void dashboardBase64Decode(const char* input, size_t len, uint8_t* output) {
+    static const char* b64chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t j = 0;
+    uint32_t buf = 0;
+    int bits = 0;
+    
+    for (size_t i = 0; i < len; i++) {
+        char c = input[i];
+        if (c == '=') break;
+        
+        const char* p = strchr(b64chars, c);
+        if (!p) continue;
+        
+        buf = (buf << 6) | (p - b64chars);
+        bits += 6;
+        
+        if (bits >= 8) {
+            bits -= 8;
+            output[j++] = (buf >> bits) & 0xFF;
+        }
+    }
+}
+
+// Mutex for state shared between tasks (no-op where there is only one task)
+#if defined(ARDUINO_ARCH_ESP8266)
+struct DashboardMutex {
+    void lock() {}
+    void unlock() {}
+};
+#else
+typedef std::mutex DashboardMutex;
+#endif
+
+// Recursive variant for the cards: callbacks run under it may call update*Card()
+#if defined(ARDUINO_ARCH_ESP8266)
+typedef DashboardMutex DashboardRecursiveMutex;
+#else
+typedef std::recursive_mutex DashboardRecursiveMutex;
+#endif
+
+// Holds a dashboard mutex until the end of the enclosing scope
+template <typename M>
+class DashboardLock {
+public:
+    explicit DashboardLock(M& mutex) : _mutex(mutex) { _mutex.lock(); }
+    ~DashboardLock() { _mutex.unlock(); }
+    DashboardLock(const DashboardLock&) = delete;
+    DashboardLock& operator=(const DashboardLock&) = delete;
+private:
+    M& _mutex;
+};
+
+/**
+ * Single-producer/single-consumer lock-free ring of fixed-size records.
+ * Records are written and read in place: the producer fills the slot returned
+ * by reserve() and calls commit(), the consumer reads front() and calls pop().
+ * N must be a power of two.
+ */
+template <typename T, size_t N>
+class SpscRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+    
+public:
+    // Producer side
+    T* reserve() {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) >= N) return nullptr;
+        return &_items[head & (N - 1)];
+    }
+    void commit() { _head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+    
+    // Consumer side
+    T* front() {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire)) return nullptr;
+        return &_items[tail & (N - 1)];
+    }
+    void pop() { _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+    
+    size_t size() const { return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire); }
+    
+private:
+    T _items[N];
+    std::atomic<uint32_t> _head{0};
+    std::atomic<uint32_t> _tail{0};
+};
+
+/**
+ * Multi-producer/single-consumer lock-free bounded queue (Vyukov). Any number
+ * of tasks may push concurrently without locks; one task pops. Each cell carries
+ * a sequence number telling producers and the consumer whose turn it is.
+ * N must be a power of two.
+ */
+template <typename T, size_t N>
+class MpscQueue {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "MpscQueue capacity must be a power of two");
+    
+public:
+    MpscQueue() {
+        for (uint32_t i = 0; i < N; i++) _cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+    
+    // Any task. Returns false when the queue is full.
+    bool push(const T& item) {
+        uint32_t pos = _head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = _cells[pos & (N - 1)];
+            int32_t diff = (int32_t)(cell.seq.load(std::memory_order_acquire) - pos);
+            if (diff == 0) {
+                if (_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.data = item;
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = _head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+    
+    // Consumer task only
+    bool pop(T& item) {
+        Cell& cell = _cells[_tail & (N - 1)];
+        if ((int32_t)(cell.seq.load(std::memory_order_acquire) - (_tail + 1)) < 0) return false;
+        item = cell.data;
+        cell.seq.store(_tail + N, std::memory_order_release);
+        _tail++;
+        return true;
+    }
+    
+private:
+    struct Cell {
+        std::atomic<uint32_t> seq;
+        T data;
+    };
+    Cell _cells[N];
+    std::atomic<uint32_t> _head{0};
+    uint32_t _tail = 0;
+};
+
+// Lock-free multi-producer / single-consumer ring of variable-length records.
+// Producers claim space with a CAS on the head and never wait; a record becomes
+// visible to the consumer when its header word is committed. The consumer zeroes
+// what it has read, so bytes of an earlier lap never look like a committed header.
+template <size_t N>
+class MpscByteRing {
+    static_assert(N >= 64 && (N & (N - 1)) == 0, "MpscByteRing size must be a power of two");
+    
+    static const uint32_t COMMITTED = 0x80000000u;
+    static const uint32_t PADDING = 0x40000000u;
+    static const uint32_t SIZE_MASK = 0x00FFFFFFu;
+    
+public:
+    // Any task. Returns space for len bytes, or nullptr when the ring is full.
+    // Every successful reserve() must be followed by commit().
+    uint8_t* reserve(size_t len) {
+        uint32_t need = (uint32_t)((4 + len + 3) & ~(size_t)3);
+        if (need > N / 2) return nullptr;
+        
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        uint32_t offset, pad;
+        for (;;) {
+            offset = head & (N - 1);
+            pad = (offset + need > N) ? N - offset : 0;  // records never wrap
+            if (head + pad + need - _tail.load(std::memory_order_acquire) > N) return nullptr;
+            if (_head.compare_exchange_weak(head, head + pad + need, std::memory_order_relaxed)) break;
+        }
+        if (pad) {
+            __atomic_store_n(&_words[offset / 4], COMMITTED | PADDING | pad, __ATOMIC_RELEASE);
+            offset = 0;
+        }
+        return (uint8_t*)&_words[offset / 4 + 1];
+    }
+    void commit(uint8_t* data, size_t len) {
+        __atomic_store_n((uint32_t*)data - 1, COMMITTED | (uint32_t)len, __ATOMIC_RELEASE);
+    }
+    
+    // Consumer task only. Oldest committed record, or false if there is none yet
+    // (a record still being written holds back the ones after it).
+    bool front(const uint8_t*& data, size_t& len) {
+        for (;;) {
+            uint32_t tail = _tail.load(std::memory_order_relaxed);
+            if (tail == _head.load(std::memory_order_acquire)) return false;
+            uint32_t header = __atomic_load_n(&_words[(tail & (N - 1)) / 4], __ATOMIC_ACQUIRE);
+            if (!(header & COMMITTED)) return false;
+            if (header & PADDING) {
+                release(tail, header & SIZE_MASK);
+                continue;
+            }
+            data = (const uint8_t*)&_words[(tail & (N - 1)) / 4 + 1];
+            len = header & SIZE_MASK;
+            return true;
+        }
+    }
+    void pop() {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        uint32_t header = __atomic_load_n(&_words[(tail & (N - 1)) / 4], __ATOMIC_RELAXED);
+        release(tail, (4 + (header & SIZE_MASK) + 3) & ~3u);
+    }
+    
+private:
+    void release(uint32_t tail, uint32_t size) {
+        memset(&_words[(tail & (N - 1)) / 4], 0, size);
+        _tail.store(tail + size, std::memory_order_release);
+    }
+    
+    uint32_t _words[N / 4] = {};
+    std::atomic<uint32_t> _head{0};
+    std::atomic<uint32_t> _tail{0};
+};
+
+#if DASHBOARD_METRICS
+// Message kinds counted by DashboardMetrics, in both directions
+enum class MetricMessage : uint8_t {
+    INIT,
+    UPDATE,
+    REMOVE,
+    LOG,
+    HEARTBEAT,
+    ACTION,
+    COMMAND,
+    SUBSCRIBE,
+    OTA,
+    ACK,
+    OTHER,
+    COUNT
+};
+
+// Latency histogram in microseconds with fixed buckets; safe to record from any task
+class MetricHistogram {
+public:
+    static const size_t BUCKETS = 10;
+    
+    // Upper bound of bucket i (the bucket after the last one is +Inf)
+    static uint32_t bound(size_t i) {
+        static const uint32_t bounds[BUCKETS] = { 50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000 };
+        return bounds[i];
+    }
+    
+    void record(uint32_t us) {
+        size_t i = 0;
+        while (i < BUCKETS && us > bound(i)) i++;
+        _buckets[i].fetch_add(1, std::memory_order_relaxed);
+        _count.fetch_add(1, std::memory_order_relaxed);
+        _sum.fetch_add(us, std::memory_order_relaxed);
+        uint32_t max = _max.load(std::memory_order_relaxed);
+        while (us > max && !_max.compare_exchange_weak(max, us, std::memory_order_relaxed)) {}
+    }
+    
+    uint32_t count() const { return _count.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return _sum.load(std::memory_order_relaxed); }
+    uint32_t max() const { return _max.load(std::memory_order_relaxed); }
+    uint32_t bucket(size_t i) const { return _buckets[i].load(std::memory_order_relaxed); }
+    
+    // Upper bound of the bucket holding the q-quantile (0 if empty, max() past the last bound)
+    uint32_t quantile(float q) const {
+        uint32_t total = count();
+        if (total == 0) return 0;
+        uint32_t target = (uint32_t)(q * total);
+        uint32_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; i++) {
+            seen += bucket(i);
+            if (seen > target) return bound(i);
+        }
+        return max();
+    }
+    
+    // Prometheus histogram lines for one metric (cumulative buckets, _sum and _count)
+    void printPrometheus(Print& out, const char* name) const {
+        out.printf("# TYPE %s histogram\n", name);
+        printPrometheusSamples(out, name, nullptr);
+    }
+    
+    // Sample lines only, with extra labels (e.g. card="led") for one series of a labelled family
+    void printPrometheusSamples(Print& out, const char* name, const char* labels) const {
+        const char* sep = labels ? "," : "";
+        if (!labels) labels = "";
+        uint32_t cumulative = 0;
+        for (size_t i = 0; i < BUCKETS; i++) {
+            cumulative += bucket(i);
+            out.printf("%s_bucket{%s%sle=\"%lu\"} %lu\n", name, labels, sep,
+                       (unsigned long)bound(i), (unsigned long)cumulative);
+        }
+        out.printf("%s_bucket{%s%sle=\"+Inf\"} %lu\n", name, labels, sep, (unsigned long)count());
+        if (*labels) {
+            out.printf("%s_sum{%s} %llu\n", name, labels, (unsigned long long)sum());
+            out.printf("%s_count{%s} %lu\n", name, labels, (unsigned long)count());
+        } else {
+            out.printf("%s_sum %llu\n", name, (unsigned long long)sum());
+            out.printf("%s_count %lu\n", name, (unsigned long)count());
+        }
+    }
+    
+    void toJson(JsonObject obj) const {
+        uint32_t n = count();
+        obj["count"] = n;
+        obj["avg"] = n ? (uint32_t)(sum() / n) : 0;
+        obj["p50"] = quantile(0.5f);
+        obj["p99"] = quantile(0.99f);
+        obj["max"] = max();
+    }
+    
+private:
+    std::atomic<uint32_t> _buckets[BUCKETS + 1] = {};
+    std::atomic<uint32_t> _count{0};
+    std::atomic<uint64_t> _sum{0};
+    std::atomic<uint32_t> _max{0};
+};
+
+// Records the lifetime of the scope into a histogram
+struct MetricTimer {
+    MetricHistogram& histogram;
+    uint32_t start;
+    explicit MetricTimer(MetricHistogram& h) : histogram(h), start(micros()) {}
+    ~MetricTimer() { histogram.record(micros() - start); }
+};
+
+/**
+ * Counters and histograms describing what the library itself costs. Updated
+ * from the network task and the dashboard context with relaxed atomics.
+ * Compiled out entirely with DASHBOARD_METRICS 0.
+ */
+class DashboardMetrics {
+public:
+    static const size_t KINDS = (size_t)MetricMessage::COUNT;
+    
+    static const char* messageName(size_t kind) {
+        static const char* const names[KINDS] = {
+            "init", "update", "remove", "log", "heartbeat",
+            "action", "command", "log_subscribe", "ota", "ack", "other"
+        };
+        return kind < KINDS ? names[kind] : "other";
+    }
+    
+    // One message of the given size sent to each of `clients` clients
+    void sent(MetricMessage kind, size_t bytes, size_t clients = 1) {
+        _sentMessages[(size_t)kind].fetch_add(clients, std::memory_order_relaxed);
+        _sentBytes[(size_t)kind].fetch_add(bytes * clients, std::memory_order_relaxed);
+    }
+    
+    void received(MetricMessage kind, size_t bytes) {
+        _receivedMessages[(size_t)kind].fetch_add(1, std::memory_order_relaxed);
+        _receivedBytes[(size_t)kind].fetch_add(bytes, std::memory_order_relaxed);
+    }
+    
+    uint32_t sentMessages(size_t kind) const { return _sentMessages[kind].load(std::memory_order_relaxed); }
+    uint32_t sentBytes(size_t kind) const { return _sentBytes[kind].load(std::memory_order_relaxed); }
+    uint32_t receivedMessages(size_t kind) const { return _receivedMessages[kind].load(std::memory_order_relaxed); }
+    uint32_t receivedBytes(size_t kind) const { return _receivedBytes[kind].load(std::memory_order_relaxed); }
+    
+    // OTA throughput: bytes written between otaStarted() and the last chunk
+    void otaStarted() {
+        _otaStartMs = millis();
+        _otaLastMs = _otaStartMs;
+        _otaBytes = 0;
+    }
+    void otaWritten(size_t bytes) {
+        _otaBytes += bytes;
+        _otaLastMs = millis();
+    }
+    uint32_t otaBytes() const { return _otaBytes; }
+    uint32_t otaBytesPerSecond() const {
+        uint32_t elapsed = _otaLastMs - _otaStartMs;
+        return elapsed ? (uint32_t)((uint64_t)_otaBytes * 1000 / elapsed) : 0;
+    }
+    
+    MetricHistogram initSerialize;    // building and serializing the init message
+    MetricHistogram updateSerialize;  // serializing one update message
+    MetricHistogram messageHandling;  // handleWebSocketMessage, parse to return
+    std::atomic<uint32_t> coalescedUpdates{0};
+    
+private:
+    std::atomic<uint32_t> _sentMessages[KINDS] = {};
+    std::atomic<uint32_t> _sentBytes[KINDS] = {};
+    std::atomic<uint32_t> _receivedMessages[KINDS] = {};
+    std::atomic<uint32_t> _receivedBytes[KINDS] = {};
+    uint32_t _otaStartMs = 0;
+    uint32_t _otaLastMs = 0;
+    uint32_t _otaBytes = 0;
+};
+
+// Summary of one loop timing series, in microseconds
+struct LoopTimingStats {
+    uint32_t count = 0;
+    uint32_t min = 0;
+    uint32_t avg = 0;
+    uint32_t max = 0;
+    uint32_t p99 = 0;  // Upper bound, within 25%
+};
+
+/**
+ * One series of durations (e.g. loop interval) summarized over a sliding window
+ * of DASHBOARD_LOOP_WINDOWS closed windows. Values go into a histogram with four
+ * buckets per power of two; closing a window reduces it to count, sum, min, max
+ * and p99. Over the sliding window, p99 is the worst of the windows' p99.
+ */
+class LoopTimingSeries {
+public:
+    static const size_t BUCKETS = 124;
+    
+    // Exact below 8 us, then 4 buckets per power of two
+    static size_t bucketOf(uint32_t us) {
+        if (us < 8) return us;
+        int e = 31 - __builtin_clz(us);
+        return (e - 1) * 4 + ((us >> (e - 2)) & 3);
+    }
+    
+    static uint32_t bucketUpperBound(size_t i) {
+        if (i < 8) return i;
+        int e = i / 4 + 1;
+        uint32_t width = 1u << (e - 2);
+        return (uint32_t)(4 + i % 4) * width + (width - 1);
+    }
+    
+    void record(uint32_t us) {
+        _buckets[bucketOf(us)]++;
+        _count++;
+        _sum += us;
+        if (_count == 1 || us < _min) _min = us;
+        if (us > _max) _max = us;
+    }
+    
+    void closeWindow() {
+        Window& w = _windows[_next];
+        w.count = _count;
+        w.sum = _sum;
+        w.min = _min;
+        w.max = _max;
+        w.p99 = 0;
+        if (_count > 0) {
+            uint32_t rank = _count - _count / 100;
+            uint32_t seen = 0;
+            for (size_t i = 0; i < BUCKETS; i++) {
+                seen += _buckets[i];
+                if (seen >= rank) {
+                    w.p99 = std::min(bucketUpperBound(i), _max);
+                    break;
+                }
+            }
+        }
+        _next = (_next + 1) % DASHBOARD_LOOP_WINDOWS;
+        memset(_buckets, 0, sizeof(_buckets));
+        _count = 0;
+        _sum = 0;
+        _min = 0;
+        _max = 0;
+    }
+    
+    LoopTimingStats stats() const {
+        LoopTimingStats s;
+        uint64_t sum = 0;
+        for (const Window& w : _windows) {
+            if (w.count == 0) continue;
+            if (s.count == 0 || w.min < s.min) s.min = w.min;
+            s.max = std::max(s.max, w.max);
+            s.p99 = std::max(s.p99, w.p99);
+            s.count += w.count;
+            sum += w.sum;
+        }
+        s.avg = s.count ? (uint32_t)(sum / s.count) : 0;
+        return s;
+    }
+    
+    // Sum of the values in the sliding window
+    uint64_t total() const {
+        uint64_t sum = 0;
+        for (const Window& w : _windows) sum += w.sum;
+        return sum;
+    }
+    
+private:
+    struct Window {
+        uint32_t count = 0;
+        uint64_t sum = 0;
+        uint32_t min = 0;
+        uint32_t max = 0;
+        uint32_t p99 = 0;
+    };
+    
+    uint32_t _buckets[BUCKETS] = {};
+    uint32_t _count = 0;
+    uint64_t _sum = 0;
+    uint32_t _min = 0;
+    uint32_t _max = 0;
+    Window _windows[DASHBOARD_LOOP_WINDOWS];
+    size_t _next = 0;
+};
+
+/**
+ * Timing of the context that runs the dashboard: loop() or the beginTask() task.
+ * interval is the time between the starts of consecutive passes, busy the time
+ * spent inside one. Recorded and summarized by that context only; other tasks
+ * may read a summary that is at most one window old.
+ */
+class LoopMonitor {
+public:
+    explicit LoopMonitor(uint32_t windowMs) : _windowMs(windowMs ? windowMs : 1000) {}
+    
+    void passStarted(uint32_t nowUs) {
+        if (_started) {
+            interval.record(nowUs - _lastStartUs);
+        } else {
+            _started = true;
+            _windowStartUs = nowUs;
+        }
+        _lastStartUs = nowUs;
+    }
+    
+    void passEnded(uint32_t nowUs) {
+        busy.record(nowUs - _lastStartUs);
+        uint32_t elapsed = nowUs - _windowStartUs;
+        if (elapsed < _windowMs * 1000) return;
+        
+        interval.closeWindow();
+        busy.closeWindow();
+        _elapsed[_next] = elapsed;
+        _next = (_next + 1) % DASHBOARD_LOOP_WINDOWS;
+        _windowStartUs = nowUs;
+#if defined(ARDUINO_ARCH_ESP32)
+        _stackHighWater = uxTaskGetStackHighWaterMark(nullptr);
+#endif
+    }
+    
+    // Share of wall time spent inside passes over the sliding window (0..1)
+    float cpuShare() const {
+        uint64_t elapsed = 0;
+        for (uint32_t e : _elapsed) elapsed += e;
+        return elapsed ? (float)busy.total() / elapsed : 0.0f;
+    }
+    
+    // Unused stack of the running task at the last window close (0 = unknown)
+    uint32_t stackHighWater() const { return _stackHighWater; }
+    
+    LoopTimingSeries interval;
+    LoopTimingSeries busy;
+    
+private:
+    uint32_t _windowMs;
+    bool _started = false;
+    uint32_t _lastStartUs = 0;
+    uint32_t _windowStartUs = 0;
+    uint32_t _elapsed[DASHBOARD_LOOP_WINDOWS] = {};
+    size_t _next = 0;
+    uint32_t _stackHighWater = 0;
+};
+#endif
+
  /**
   * Dashboard Card Base Class
   */
@@ -148,15 +947,33 @@ public:
     int weight;  // Lower weight = shown first (default: 0)
     int sizeX;   // Grid column span (default: 1)
     int sizeY;   // Grid row span (default: 1)
+    uint32_t serial = 0;  // Assigned when added, tells a reallocated card from a removed one
+    uint8_t dispatching = 0;  // Callbacks running on it; removeCard() leaves deleting it to them
+    bool removed = false;
+#if DASHBOARD_METRICS
+    // Receive-to-callback-end time of this card's actions, allocated on the first action
+    std::atomic<MetricHistogram*> actionLatency{nullptr};
+#endif
     
     DashboardCard(const String& id, CardType type, const String& title)
         : id(id), type(type), title(title), variant(CardVariant::PRIMARY), weight(0), sizeX(1), sizeY(1) {}
      
-     virtual ~DashboardCard() {}
+     virtual ~DashboardCard() {
+#if DASHBOARD_METRICS
+         delete actionLatency.load();
+#endif
+     }
      
      virtual void toJson(JsonObject& card) = 0;
      virtual void handleAction(const String& action, JsonObject& data) {}
-     
+
+     // Called by the dashboard for inbound actions. `action` points into the parsed
+     // message and `actionHash` is dashboardHash(action). Built-in cards override this;
+     // the default forwards to handleAction() so custom cards keep working.
+     virtual void dispatchAction(uint32_t actionHash, const char* action, JsonObject& data) {
+         handleAction(String(action), data);
+     }
+
     void setVariant(CardVariant v) { variant = v; }
     void setWeight(int w) { weight = w; }
     int getWeight() const { return weight; }
@@ -438,8 +1255,8 @@ public:
         if (sizeY > 1) config["sizeY"] = sizeY;
     }
      
-     void handleAction(const String& action, JsonObject& data) override {
-         if (action == "click" && callback) {
+     void dispatchAction(uint32_t actionHash, const char* action, JsonObject& data) override {
+         if (actionHash == dashboardHash("click") && callback) {
              callback();
          }
      }
@@ -507,11 +1324,11 @@ public:
         if (sizeY > 1) config["sizeY"] = sizeY;
     }
      
-     void handleAction(const String& action, JsonObject& data) override {
-         if (action == "timezone" && callback) {
-             String tz = data["timezone"].as<String>();
+     void dispatchAction(uint32_t actionHash, const char* action, JsonObject& data) override {
+         if (actionHash == dashboardHash("timezone") && callback) {
+             String tz = data["timezone"] | "";
              int offset = data["offset"].as<int>();
-             String offsetStr = data["offsetString"].as<String>();
+             String offsetStr = data["offsetString"] | "";
              value = tz + " (" + offsetStr + ")";
              callback(tz, offset, offsetStr);
          }
@@ -548,8 +1365,8 @@ public:
         if (sizeY > 1) config["sizeY"] = sizeY;
     }
      
-     void handleAction(const String& action, JsonObject& data) override {
-         if (action == "change" && !data["value"].isNull()) {
+     void dispatchAction(uint32_t actionHash, const char* action, JsonObject& data) override {
+         if (actionHash == dashboardHash("change") && !data["value"].isNull()) {
              value = data["value"].as<String>();
              if (callback) callback(value);
          }
@@ -584,8 +1401,8 @@ public:
         if (sizeY > 1) config["sizeY"] = sizeY;
     }
      
-     void handleAction(const String& action, JsonObject& data) override {
-         if (action == "change" && !data["value"].isNull()) {
+     void dispatchAction(uint32_t actionHash, const char* action, JsonObject& data) override {
+         if (actionHash == dashboardHash("change") && !data["value"].isNull()) {
              value = data["value"].as<String>();
              if (callback) callback(value);
          }
@@ -624,8 +1441,8 @@ public:
         if (sizeY > 1) config["sizeY"] = sizeY;
     }
      
-     void handleAction(const String& action, JsonObject& data) override {
-         if (action == "location") {
+     void dispatchAction(uint32_t actionHash, const char* action, JsonObject& data) override {
+         if (actionHash == dashboardHash("location")) {
              latitude = data["latitude"].as<float>();
              longitude = data["longitude"].as<float>();
              if (callback) callback(latitude, longitude);
@@ -669,8 +1486,8 @@ public:
         if (sizeY > 1) config["sizeY"] = sizeY;
     }
      
-     void handleAction(const String& action, JsonObject& data) override {
-         if (action == "confirm" && callback) {
+     void dispatchAction(uint32_t actionHash, const char* action, JsonObject& data) override {
+         if (actionHash == dashboardHash("confirm") && callback) {
              callback();
          }
      }
@@ -714,13 +1531,12 @@ public:
         if (sizeY > 1) config["sizeY"] = sizeY;
     }
      
-     void handleAction(const String& action, JsonObject& data) override {
+     void dispatchAction(uint32_t actionHash, const char* action, JsonObject& data) override {
          if (!data["value"].isNull()) {
              value = data["value"].as<String>();
-             if (action == "change" && onChange) {
-                 onChange(value);
-             } else if (action == "submit" && onSubmit) {
-                 onSubmit(value);
+             switch (actionHash) {
+                 case dashboardHash("change"): if (onChange) onChange(value); break;
+                 case dashboardHash("submit"): if (onSubmit) onSubmit(value); break;
              }
          }
      }
@@ -767,8 +1583,8 @@ public:
         if (sizeY > 1) config["sizeY"] = sizeY;
     }
      
-     void handleAction(const String& action, JsonObject& data) override {
-         if (action == "change" && !data["color"].isNull()) {
+     void dispatchAction(uint32_t actionHash, const char* action, JsonObject& data) override {
+         if (actionHash == dashboardHash("change") && !data["color"].isNull()) {
              value = data["color"].as<String>();
              if (onChange) {
                  onChange(value);
@@ -811,8 +1627,8 @@ public:
         if (sizeY > 1) config["sizeY"] = sizeY;
     }
      
-     void handleAction(const String& action, JsonObject& data) override {
-         if (action == "change" && !data["value"].isNull()) {
+     void dispatchAction(uint32_t actionHash, const char* action, JsonObject& data) override {
+         if (actionHash == dashboardHash("change") && !data["value"].isNull()) {
              value = data["value"].as<String>();
              if (onChange) {
                  onChange(value);
@@ -851,8 +1667,8 @@ public:
         if (sizeY > 1) config["sizeY"] = sizeY;
     }
      
-     void handleAction(const String& action, JsonObject& data) override {
-         if (action == "change" && !data["value"].isNull()) {
+     void dispatchAction(uint32_t actionHash, const char* action, JsonObject& data) override {
+         if (actionHash == dashboardHash("change") && !data["value"].isNull()) {
              value = data["value"].as<bool>();
              if (onChange) {
                  onChange(value);
@@ -891,8 +1707,8 @@ public:
         if (sizeY > 1) config["sizeY"] = sizeY;
     }
      
-     void handleAction(const String& action, JsonObject& data) override {
-         if (action == "change" && !data["value"].isNull()) {
+     void dispatchAction(uint32_t actionHash, const char* action, JsonObject& data) override {
+         if (actionHash == dashboardHash("change") && !data["value"].isNull()) {
              value = data["value"].as<int>();
              if (onChange) {
                  onChange(value);
@@ -963,19 +1779,35 @@ public:
  
  /**
   * Console Log Card - Displays timestamped log entries
+  * 
+  * Entries live in a byte ring allocated once at construction: a packed header
+  * (millis, level, length) followed by the message bytes. The oldest entries are
+  * evicted in O(1) when the ring or maxEntries is full, and timestamps are only
+  * formatted when the card is serialized.
   */
  class ConsoleCard : public DashboardCard {
  public:
-     std::vector<LogEntry> logs;
      int maxEntries;
      bool autoScroll;
      std::function<void()> onClear;
      std::function<void(const String&)> onCommand;
      
-     ConsoleCard(const String& id, const String& title = "Console Log", int maxEntries = 100)
-         : DashboardCard(id, CardType::CONSOLE, title), maxEntries(maxEntries), autoScroll(true) {}
+     /**
+      * @param bufferSize Ring size in bytes (0 = maxEntries * DASHBOARD_CONSOLE_BYTES_PER_ENTRY)
+      */
+     ConsoleCard(const String& id, const String& title = "Console Log", int maxEntries = 100, size_t bufferSize = 0)
+         : DashboardCard(id, CardType::CONSOLE, title), maxEntries(maxEntries), autoScroll(true),
+           _capacity(bufferSize ? bufferSize : (size_t)maxEntries * DASHBOARD_CONSOLE_BYTES_PER_ENTRY) {
+         if (_capacity < HEADER_SIZE + 1) _capacity = HEADER_SIZE + 1;
+         _buffer = new uint8_t[_capacity];
+     }
      
-    void toJson(JsonObject& card) override {
+     ~ConsoleCard() { delete[] _buffer; }
+     
+     ConsoleCard(const ConsoleCard&) = delete;
+     ConsoleCard& operator=(const ConsoleCard&) = delete;
+     
+    void toJson(JsonObject& card) override {
         card["id"] = id;
         card["type"] = typeToString(type);
         card["weight"] = weight;
@@ -983,57 +1815,716 @@ public:
         config["title"] = title;
         config["autoScroll"] = autoScroll;
         JsonArray logsArr = config.createNestedArray("logs");
-        for (const LogEntry& entry : logs) {
+        forEachLog([&](uint32_t ms, LogLevel level, const char* message, size_t len) {
+            char timestamp[16];
+            formatTimestamp(ms, timestamp, sizeof(timestamp));
             JsonObject logObj = logsArr.createNestedObject();
-            logObj["timestamp"] = entry.timestamp;
-            logObj["level"] = logLevelToString(entry.level);
-            logObj["message"] = entry.message;
-        }
+            logObj["timestamp"] = timestamp;
+            logObj["level"] = logLevelToString(level);
+            logObj["message"] = message;
+        });
     }
      
-     void handleAction(const String& action, JsonObject& data) override {
-         if (action == "clear") {
-             logs.clear();
-             if (onClear) onClear();
-         } else if (action == "command" && !data["command"].isNull()) {
-             String cmd = data["command"].as<String>();
-             if (onCommand) onCommand(cmd);
+     void dispatchAction(uint32_t actionHash, const char* action, JsonObject& data) override {
+         switch (actionHash) {
+             case dashboardHash("clear"):
+                 clear();
+                 if (onClear) onClear();
+                 break;
+             case dashboardHash("command"):
+                 if (onCommand && !data["command"].isNull()) {
+                     onCommand(data["command"].as<String>());
+                 }
+                 break;
          }
      }
      
      void addLog(LogLevel level, const String& message) {
-         LogEntry entry;
-         entry.timestamp = getTimestamp();
-         entry.level = level;
-         entry.message = message;
+         addLog(level, message.c_str(), message.length());
+     }
+     
+     // Messages longer than DASHBOARD_CONSOLE_MAX_MESSAGE are truncated
+     void addLog(LogLevel level, const char* message, size_t len, uint32_t timestampMs = millis()) {
+         len = dashboardUtf8Cut(message, len, DASHBOARD_CONSOLE_MAX_MESSAGE);
+         if (HEADER_SIZE + len > _capacity) len = dashboardUtf8Cut(message, len, _capacity - HEADER_SIZE);
+         size_t total = HEADER_SIZE + len;
          
-         logs.push_back(entry);
+         // Evict oldest entries until the new one fits
+         while (_count > 0 && (_used + total > _capacity || (int)_count >= maxEntries)) {
+             evictOldest();
+         }
+         
+         uint8_t header[HEADER_SIZE];
+         uint16_t len16 = (uint16_t)len;
+         memcpy(header, &timestampMs, 4);
+         header[4] = (uint8_t)level;
+         memcpy(header + 5, &len16, 2);
+         writeBytes(_head, header, HEADER_SIZE);
+         writeBytes((_head + HEADER_SIZE) % _capacity, (const uint8_t*)message, len);
          
-         // Trim old entries if exceeding max
-         while (logs.size() > maxEntries) {
-             logs.erase(logs.begin());
+         _head = (_head + total) % _capacity;
+         _used += total;
+         _count++;
+     }
+     
+     void clear() {
+         _head = 0;
+         _tail = 0;
+         _used = 0;
+         _count = 0;
+     }
+     
+     size_t logCount() const { return _count; }
+     
+     /**
+      * Visit entries from oldest to newest. The message pointer is only valid
+      * during the callback and is null-terminated.
+      */
+     template <typename Fn>
+     void forEachLog(Fn fn) const {
+         char message[DASHBOARD_CONSOLE_MAX_MESSAGE + 1];
+         size_t pos = _tail;
+         for (size_t i = 0; i < _count; i++) {
+             uint32_t ms;
+             LogLevel level;
+             size_t len;
+             readHeader(pos, ms, level, len);
+             readBytes((pos + HEADER_SIZE) % _capacity, (uint8_t*)message, len);
+             message[len] = '\0';
+             fn(ms, level, (const char*)message, len);
+             pos = (pos + HEADER_SIZE + len) % _capacity;
          }
      }
      
-     void clear() { logs.clear(); }
+     // Copy of the current entries in the LogEntry form (allocates; for diagnostics)
+     std::vector<LogEntry> getLogs() const {
+         std::vector<LogEntry> result;
+         result.reserve(_count);
+         forEachLog([&](uint32_t ms, LogLevel level, const char* message, size_t len) {
+             char timestamp[16];
+             formatTimestamp(ms, timestamp, sizeof(timestamp));
+             result.push_back({String(timestamp), level, String(message)});
+         });
+         return result;
+     }
      
      // Public accessor for log level string conversion
      String getLogLevelString(LogLevel level) { return logLevelToString(level); }
      
- private:
-     String getTimestamp() {
-         unsigned long ms = millis();
+     // HH:MM:SS.mmm since boot
+     static void formatTimestamp(uint32_t ms, char* buf, size_t size) {
          unsigned long secs = ms / 1000;
          unsigned long mins = secs / 60;
          unsigned long hours = mins / 60;
-         
-         char buf[16];
-         snprintf(buf, sizeof(buf), "%02lu:%02lu:%02lu.%03lu", 
-                  hours % 24, mins % 60, secs % 60, ms % 1000);
-         return String(buf);
+         snprintf(buf, size, "%02lu:%02lu:%02lu.%03lu", 
+                  hours % 24, mins % 60, secs % 60, (unsigned long)(ms % 1000));
+     }
+     
+ private:
+     static const size_t HEADER_SIZE = 7;  // uint32 millis, uint8 level, uint16 length
+     
+     uint8_t* _buffer;
+     size_t _capacity;
+     size_t _head = 0;   // Next write offset
+     size_t _tail = 0;   // Oldest entry offset
+     size_t _used = 0;
+     size_t _count = 0;
+     
+     void writeBytes(size_t pos, const uint8_t* src, size_t len) {
+         size_t first = std::min(len, _capacity - pos);
+         memcpy(_buffer + pos, src, first);
+         if (len > first) memcpy(_buffer, src + first, len - first);
+     }
+     
+     void readBytes(size_t pos, uint8_t* dst, size_t len) const {
+         size_t first = std::min(len, _capacity - pos);
+         memcpy(dst, _buffer + pos, first);
+         if (len > first) memcpy(dst + first, _buffer, len - first);
+     }
+     
+     void readHeader(size_t pos, uint32_t& ms, LogLevel& level, size_t& len) const {
+         uint8_t header[HEADER_SIZE];
+         uint16_t len16;
+         readBytes(pos, header, HEADER_SIZE);
+         memcpy(&ms, header, 4);
+         level = (LogLevel)header[4];
+         memcpy(&len16, header + 5, 2);
+         len = len16;
+     }
+     
+     void evictOldest() {
+         uint32_t ms;
+         LogLevel level;
+         size_t len;
+         readHeader(_tail, ms, level, len);
+         _tail = (_tail + HEADER_SIZE + len) % _capacity;
+         _used -= HEADER_SIZE + len;
+         _count--;
      }
  };
  
+#if defined(ARDUINO_ARCH_ESP32)
+/**
+ * Persistent console history - an append-only log ring on flash (e.g. LittleFS).
+ * 
+ * Lines are kept in numbered segment files "<dir>/<seq>.log"; when the newest
+ * segment reaches maxBytes / DASHBOARD_LOG_STORE_SEGMENTS a new one is started
+ * and the oldest is deleted. Each line is "<boot>\t<ms>\t<level>\t<tag>\t<message>\n",
+ * where boot counts device starts so that history survives reboots.
+ * 
+ * append() only copies into a RAM buffer; flush() writes a whole buffer at once
+ * to keep flash wear low. Two buffers are swapped so logging never waits for flash.
+ */
+class DashboardLogStore {
+public:
+    DashboardLogStore(fs::FS& fs, const char* dir, size_t maxBytes, LogLevel minLevel)
+        : _fs(fs), _dir(dir), _segmentBytes(maxBytes / DASHBOARD_LOG_STORE_SEGMENTS), _minLevel(minLevel) {}
+    
+    ~DashboardLogStore() {
+        delete[] _buffers[0];
+        delete[] _buffers[1];
+    }
+    
+    DashboardLogStore(const DashboardLogStore&) = delete;
+    DashboardLogStore& operator=(const DashboardLogStore&) = delete;
+    
+    // Allocate the buffers, find the existing segments and count this boot
+    bool begin() {
+        _buffers[0] = new (std::nothrow) char[DASHBOARD_LOG_STORE_BUFFER];
+        _buffers[1] = new (std::nothrow) char[DASHBOARD_LOG_STORE_BUFFER];
+        if (!_buffers[0] || !_buffers[1]) return false;
+        
+        if (!_fs.exists(_dir)) _fs.mkdir(_dir);
+        File root = _fs.open(_dir);
+        if (!root || !root.isDirectory()) return false;
+        
+        bool found = false;
+        for (File f = root.openNextFile(); f; f = root.openNextFile()) {
+            const char* name = strrchr(f.name(), '/');
+            name = name ? name + 1 : f.name();
+            char* end;
+            unsigned long seq = strtoul(name, &end, 10);
+            if (end == name || strcmp(end, ".log") != 0) continue;
+            if (!found || seq < _firstSeq) _firstSeq = seq;
+            if (!found || seq >= _seq) {
+                _seq = seq;
+                _segmentSize = f.size();
+            }
+            found = true;
+        }
+        
+        String bootPath = _dir + "/boot";
+        File boot = _fs.open(bootPath, "r");
+        if (boot) {
+            char num[12] = {0};
+            boot.read((uint8_t*)num, sizeof(num) - 1);
+            _boot = strtoul(num, nullptr, 10);
+            boot.close();
+        }
+        _boot++;
+        boot = _fs.open(bootPath, "w");
+        if (boot) {
+            boot.print(_boot);
+            boot.close();
+        }
+        return true;
+    }
+    
+    LogLevel minLevel() const { return _minLevel; }
+    uint32_t bootCount() const { return _boot; }
+    uint32_t droppedLines() const { return _dropped; }
+    
+    // Any task. Copies the line into the active buffer; drops it if the buffer is full.
+    void append(LogLevel level, const char* tag, const char* message, size_t len, uint32_t ms) {
+        static const char levelChars[] = { 'D', 'I', 'W', 'E' };
+        char head[48];
+        int headLen = snprintf(head, sizeof(head), "%lu\t%lu\t%c\t%.24s\t",
+                               (unsigned long)_boot, (unsigned long)ms,
+                               levelChars[(uint8_t)level & 3], tag ? tag : "");
+        if (headLen < 0) return;
+        
+        _mutex.lock();
+        char* buf = _buffers[_active];
+        size_t need = headLen + len + 1;
+        if (_fill + need > DASHBOARD_LOG_STORE_BUFFER) {
+            _dropped++;
+        } else {
+            memcpy(buf + _fill, head, headLen);
+            // Keep one line per record: embedded newlines would split it
+            for (size_t i = 0; i < len; i++) {
+                char c = message[i];
+                buf[_fill + headLen + i] = (c == '\n' || c == '\r' || c == '\t') ? ' ' : c;
+            }
+            buf[_fill + need - 1] = '\n';
+            if (_fill == 0) _fillStart = millis();
+            _fill += need;
+        }
+        _mutex.unlock();
+    }
+    
+    // Worth writing now: the buffer is half full, has been waiting too long or a
+    // history request is waiting for it
+    bool needsFlush() const {
+        return _flushRequested.load(std::memory_order_relaxed) ||
+               _fill >= DASHBOARD_LOG_STORE_BUFFER / 2 ||
+               (_fill > 0 && millis() - _fillStart >= DASHBOARD_LOG_STORE_FLUSH_MS);
+    }
+    
+    // Write the buffered lines to the newest segment, rotating segments as needed
+    void flush() {
+        _writeMutex.lock();
+        _mutex.lock();
+        char* buf = _buffers[_active];
+        size_t len = _fill;
+        _active ^= 1;
+        _fill = 0;
+        _mutex.unlock();
+        
+        if (len > 0) {
+            if (_segmentSize > 0 && _segmentSize + len > _segmentBytes) {
+                _seq++;
+                _segmentSize = 0;
+                while (_seq - _firstSeq >= DASHBOARD_LOG_STORE_SEGMENTS) {
+                    // Readers skip a segment that disappears under them
+                    _fs.remove(segmentPath(_firstSeq));
+                    _firstSeq++;
+                }
+            }
+            File f = _fs.open(segmentPath(_seq), "a");
+            if (f) {
+                _segmentSize += f.write((const uint8_t*)buf, len);
+                f.close();
+            }
+        }
+        _flushRequested.store(false, std::memory_order_relaxed);
+        _writeMutex.unlock();
+    }
+    
+    /**
+     * Stream the stored history as text/plain without loading it into RAM.
+     * Query parameters (all optional): level=debug|info|warning|error (minimum),
+     * boot=<n> (one boot; "current" for this one), from=<ms>, to=<ms> (uptime range).
+     * Runs on the network task, so it never writes to flash: lines still in RAM
+     * are flushed by loop(), and the response waits up to FLUSH_WAIT_MS for that.
+     */
+    void handleRequest(AsyncWebServerRequest* request) {
+        _flushRequested.store(true, std::memory_order_relaxed);
+        
+        std::shared_ptr<HistoryCursor> cursor = std::make_shared<HistoryCursor>();
+        cursor->requestMs = millis();
+        if (request->hasParam("level")) {
+            const String& level = request->getParam("level")->value();
+            cursor->minLevel = level == "info" ? 'I' : level == "warning" ? 'W' : level == "error" ? 'E' : 'D';
+        }
+        if (request->hasParam("boot")) {
+            const String& boot = request->getParam("boot")->value();
+            cursor->boot = boot == "current" ? _boot : strtoul(boot.c_str(), nullptr, 10);
+        }
+        if (request->hasParam("from")) cursor->from = strtoul(request->getParam("from")->value().c_str(), nullptr, 10);
+        if (request->hasParam("to")) cursor->to = strtoul(request->getParam("to")->value().c_str(), nullptr, 10);
+        
+        AsyncWebServerResponse* response = request->beginChunkedResponse("text/plain",
+            [this, cursor](uint8_t* buffer, size_t maxLen, size_t) -> size_t {
+                return readHistory(*cursor, (char*)buffer, maxLen);
+            });
+        response->addHeader("Cache-Control", "no-store");
+        request->send(response);
+    }
+    
+private:
+    static const uint32_t FLUSH_WAIT_MS = 500;
+    
+    struct HistoryCursor {
+        bool started = false;
+        unsigned long requestMs = 0;
+        uint32_t seq = 0;
+        uint32_t last = 0;
+        size_t offset = 0;
+        char minLevel = 'D';
+        uint32_t boot = 0;  // 0 = all boots
+        uint32_t from = 0;
+        uint32_t to = UINT32_MAX;
+    };
+    
+    String segmentPath(uint32_t seq) const {
+        return _dir + "/" + String(seq) + ".log";
+    }
+    
+    // Fill buffer with the next matching lines from at most one read of one segment;
+    // 0 ends the response, RESPONSE_TRY_AGAIN asks for another call
+    size_t readHistory(HistoryCursor& cursor, char* buffer, size_t maxLen) {
+        if (!cursor.started) {
+            if (_flushRequested.load(std::memory_order_relaxed) && millis() - cursor.requestMs < FLUSH_WAIT_MS) {
+                return RESPONSE_TRY_AGAIN;
+            }
+            cursor.started = true;
+            cursor.seq = _firstSeq;
+            cursor.last = _seq;
+        }
+        if (cursor.seq > cursor.last) return 0;
+        
+        File f = _fs.open(segmentPath(cursor.seq), "r");
+        size_t size = f ? f.size() : 0;
+        size_t n = 0;
+        if (cursor.offset < size) {
+            f.seek(cursor.offset);
+            n = f.read((uint8_t*)buffer, maxLen);
+        }
+        if (f) f.close();
+        if (n == 0) {
+            cursor.seq++;
+            cursor.offset = 0;
+            return cursor.seq <= cursor.last ? RESPONSE_TRY_AGAIN : 0;
+        }
+        
+        // Only hand out whole lines; the rest is read again next time
+        size_t end = n;
+        if (buffer[n - 1] != '\n' && cursor.offset + n < size) {
+            while (end > 0 && buffer[end - 1] != '\n') end--;
+            if (end == 0) end = n;  // line longer than the chunk: pass it through
+        }
+        cursor.offset += end;
+        
+        size_t out = filterLines(cursor, buffer, end);
+        return out > 0 ? out : RESPONSE_TRY_AGAIN;
+    }
+    
+    // Decimal digits from p up to end; p is left on the first other character
+    static uint32_t parseDecimal(const char*& p, const char* end) {
+        uint32_t value = 0;
+        while (p < end && *p >= '0' && *p <= '9') value = value * 10 + (uint32_t)(*p++ - '0');
+        return value;
+    }
+    
+    // Compact the lines of buffer[0..len) that match the cursor filter to the front
+    static size_t filterLines(const HistoryCursor& cursor, char* buffer, size_t len) {
+        static const char levels[] = "DIWE";
+        size_t out = 0;
+        size_t pos = 0;
+        while (pos < len) {
+            char* line = buffer + pos;
+            char* nl = (char*)memchr(line, '\n', len - pos);
+            size_t lineLen = nl ? (size_t)(nl - line) + 1 : len - pos;
+            pos += lineLen;
+            
+            // The buffer is not terminated, so every field is read within the line
+            const char* end = line + lineLen;
+            const char* p = line;
+            uint32_t boot = parseDecimal(p, end);
+            uint32_t ms = 0;
+            if (p < end && *p == '\t') ms = parseDecimal(++p, end);
+            char level = (p + 1 < end && *p == '\t') ? p[1] : 'I';
+            const char* levelPos = strchr(levels, level);
+            const char* minPos = strchr(levels, cursor.minLevel);
+            if (cursor.boot && boot != cursor.boot) continue;
+            if (ms < cursor.from || ms > cursor.to) continue;
+            if (levelPos && minPos && levelPos < minPos) continue;
+            
+            memmove(buffer + out, line, lineLen);
+            out += lineLen;
+        }
+        return out;
+    }
+    
+    fs::FS& _fs;
+    String _dir;
+    size_t _segmentBytes;
+    LogLevel _minLevel;
+    // Written by flush(), read by history requests on the network task
+    std::atomic<uint32_t> _seq{0};
+    std::atomic<uint32_t> _firstSeq{0};
+    std::atomic<bool> _flushRequested{false};
+    size_t _segmentSize = 0;
+    uint32_t _boot = 0;
+    
+    DashboardMutex _mutex;       // guards the active buffer
+    DashboardMutex _writeMutex;  // serializes flush()
+    char* _buffers[2] = { nullptr, nullptr };
+    uint8_t _active = 0;
+    size_t _fill = 0;
+    unsigned long _fillStart = 0;
+    uint32_t _dropped = 0;
+};
+#endif
+
+// publishUpdate() overloads, in the order of ESPDashboardPlus's update queue records
+// and of PUBLISH records in a traffic recording
+enum class DashboardUpdateKind : uint8_t { STAT_TEXT, STAT_NUMBER, GAUGE, CHART, CHART_SERIES, TOGGLE, SLIDER };
+
+/**
+ * Traffic recorder - captures what drives the dashboard so that a run can be
+ * replayed on the host (extras/native/replay.cpp).
+ * 
+ * Log format (integers little-endian, "varint" = unsigned LEB128):
+ *   header   "EDRC", version byte (2)
+ *   record   kind byte, varint microseconds since the previous record, body:
+ *     CARD        varint max data points, ChartType byte (both 0 for other
+ *                 cards; not in version 1), varint length, card JSON as in
+ *                 the init message
+ *     CONNECT     varint client id
+ *     DISCONNECT  varint client id
+ *     FRAME       varint client id, varint length, inbound message
+ *     UPDATE      Update byte, card id, arguments of the update*Card() call
+ *     PUBLISH     DashboardUpdateKind byte, card id, arg byte, 4 value bytes, text
+ *   strings are a varint length followed by the bytes, floats 4 bytes IEEE 754.
+ * 
+ * Like DashboardLogStore, records are copied into one of two RAM buffers from
+ * any task and written out by flush() from loop(); records that do not fit
+ * are dropped and counted. The card snapshots written by startRecording() are
+ * never dropped (appendOrWrite()).
+ */
+class DashboardRecorder {
+public:
+    enum Kind : uint8_t { CARD = 1, CONNECT, DISCONNECT, FRAME, UPDATE, PUBLISH };
+    
+    // update*Card() calls, in the order of their arguments
+    enum class Update : uint8_t {
+        STAT,          // value
+        STATUS,        // icon byte, variant byte, label, message
+        CHART,         // float
+        CHART_SERIES,  // varint series, float
+        GAUGE,         // float
+        TOGGLE,        // bool byte
+        SLIDER,        // int32
+        COLOR,         // color
+        DROPDOWN,      // value
+        DATE,          // value
+        TIME,          // value
+        LOCATION,      // float latitude, float longitude
+        LINK           // url
+    };
+    
+    /**
+     * One record under construction; appended when it goes out of scope.
+     * Strings are cut short to fit DASHBOARD_RECORDER_ENTRY_SIZE; a record whose
+     * fixed-size fields do not fit is dropped.
+     */
+    class Entry {
+    public:
+        Entry(DashboardRecorder* recorder, Kind kind) : _recorder(recorder), _kind(kind) {}
+        Entry(Entry&& other)
+            : _recorder(other._recorder), _kind(other._kind), _len(other._len), _overflow(other._overflow) {
+            memcpy(_body, other._body, _len);
+            other._recorder = nullptr;
+        }
+        Entry(const Entry&) = delete;
+        Entry& operator=(const Entry&) = delete;
+        ~Entry() {
+            if (!_recorder) return;
+            if (_overflow) _recorder->_dropped.fetch_add(1, std::memory_order_relaxed);
+            else _recorder->append(_kind, _body, _len, nullptr, 0);
+        }
+        
+        Entry& u8(uint8_t v) {
+            if (_len < sizeof(_body)) _body[_len++] = v;
+            else _overflow = true;
+            return *this;
+        }
+        Entry& varint(uint32_t v) {
+            size_t n = DashboardRecorder::putVarint(v, _body + _len, sizeof(_body) - _len);
+            if (n == 0) _overflow = true;
+            _len += n;
+            return *this;
+        }
+        Entry& i32(int32_t v) {
+            if (_len + 4 > sizeof(_body)) {
+                _overflow = true;
+                return *this;
+            }
+            for (int i = 0; i < 4; i++) _body[_len++] = (uint8_t)((uint32_t)v >> (i * 8));
+            return *this;
+        }
+        Entry& f32(float v) {
+            int32_t bits;
+            memcpy(&bits, &v, sizeof(bits));
+            return i32(bits);
+        }
+        Entry& str(const char* s, size_t len) {
+            size_t room = sizeof(_body) - _len;
+            if (room < 5) {
+                _overflow = true;
+                return *this;
+            }
+            if (len > room - 5) len = room - 5;
+            varint((uint32_t)len);
+            memcpy(_body + _len, s, len);
+            _len += len;
+            return *this;
+        }
+        Entry& str(const String& s) { return str(s.c_str(), s.length()); }
+        
+    private:
+        DashboardRecorder* _recorder;
+        Kind _kind;
+        size_t _len = 0;
+        bool _overflow = false;
+        uint8_t _body[DASHBOARD_RECORDER_ENTRY_SIZE];
+    };
+    
+    DashboardRecorder() = default;
+    ~DashboardRecorder() {
+        delete[] _buffers[0];
+        delete[] _buffers[1];
+    }
+    
+    DashboardRecorder(const DashboardRecorder&) = delete;
+    DashboardRecorder& operator=(const DashboardRecorder&) = delete;
+    
+    // Allocate the buffers (once) and write the header to out
+    bool start(Print& out) {
+        if (!_buffers[0]) _buffers[0] = new (std::nothrow) uint8_t[DASHBOARD_RECORDER_BUFFER];
+        if (!_buffers[1]) _buffers[1] = new (std::nothrow) uint8_t[DASHBOARD_RECORDER_BUFFER];
+        if (!_buffers[0] || !_buffers[1]) return false;
+        
+        _writeMutex.lock();
+        _mutex.lock();
+        _out = &out;
+        _dropped.store(0, std::memory_order_relaxed);
+        _lastUs = micros();
+        static const uint8_t header[] = { 'E', 'D', 'R', 'C', 2 };
+        memcpy(_buffers[_active], header, sizeof(header));
+        _fill = sizeof(header);
+        _fillStart = millis();
+        _mutex.unlock();
+        _writeMutex.unlock();
+        _recording.store(true, std::memory_order_release);
+        return true;
+    }
+    
+    // Write what is buffered and detach from the output (the caller closes it)
+    void stop() {
+        _recording.store(false, std::memory_order_release);
+        flush();
+        _writeMutex.lock();
+        _mutex.lock();
+        _out = nullptr;
+        _fill = 0;
+        _mutex.unlock();
+        _writeMutex.unlock();
+    }
+    
+    bool active() const { return _recording.load(std::memory_order_acquire); }
+    uint32_t droppedRecords() const { return _dropped.load(std::memory_order_relaxed); }
+    
+    Entry entry(Kind kind) { return Entry(active() ? this : nullptr, kind); }
+    
+    Entry update(Update what, const String& cardId) {
+        Entry e = entry(UPDATE);
+        e.u8((uint8_t)what).str(cardId);
+        return e;
+    }
+    
+    // Any task. A small head (client id, length) followed by the message bytes.
+    void frame(uint32_t clientId, const uint8_t* data, size_t len) {
+        if (!active()) return;
+        uint8_t head[10];
+        size_t headLen = putVarint(clientId, head, sizeof(head));
+        headLen += putVarint((uint32_t)len, head + headLen, sizeof(head) - headLen);
+        append(FRAME, head, headLen, data, len);
+    }
+    
+    // Any task. Copies the record into the active buffer; drops it if the buffer is full.
+    void append(Kind kind, const uint8_t* head, size_t headLen, const uint8_t* payload, size_t payloadLen) {
+        _mutex.lock();
+        if (!_out) {
+            _mutex.unlock();
+            return;
+        }
+        uint32_t now = micros();
+        uint8_t prefix[PREFIX_SIZE];
+        size_t prefixLen = putPrefix(kind, now, prefix);
+        size_t need = prefixLen + headLen + payloadLen;
+        if (_fill + need > DASHBOARD_RECORDER_BUFFER) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            uint8_t* buf = _buffers[_active];
+            memcpy(buf + _fill, prefix, prefixLen);
+            if (headLen) memcpy(buf + _fill + prefixLen, head, headLen);
+            if (payloadLen) memcpy(buf + _fill + prefixLen + headLen, payload, payloadLen);
+            if (_fill == 0) _fillStart = millis();
+            _fill += need;
+            _lastUs = now;
+        }
+        _mutex.unlock();
+    }
+    
+    // loop() only. Like append(), but never drops the record: the buffer is flushed
+    // first when the record does not fit, and a record larger than a whole buffer
+    // (a big card snapshot) is written straight to the output after what is buffered.
+    void appendOrWrite(Kind kind, const uint8_t* head, size_t headLen, const uint8_t* payload, size_t payloadLen) {
+        size_t need = PREFIX_SIZE + headLen + payloadLen;
+        if (need <= DASHBOARD_RECORDER_BUFFER) {
+            if (_fill + need > DASHBOARD_RECORDER_BUFFER) flush();
+            append(kind, head, headLen, payload, payloadLen);
+            return;
+        }
+        
+        _writeMutex.lock();
+        _mutex.lock();
+        if (_out) {
+            if (_fill > 0) _out->write(_buffers[_active], _fill);
+            _fill = 0;
+            uint32_t now = micros();
+            uint8_t prefix[PREFIX_SIZE];
+            _out->write(prefix, putPrefix(kind, now, prefix));
+            if (headLen) _out->write(head, headLen);
+            if (payloadLen) _out->write(payload, payloadLen);
+            _lastUs = now;
+        }
+        _mutex.unlock();
+        _writeMutex.unlock();
+    }
+    
+    // Worth writing now: the buffer is half full or has been waiting a second
+    bool needsFlush() const {
+        return _fill >= DASHBOARD_RECORDER_BUFFER / 2 || (_fill > 0 && millis() - _fillStart >= 1000);
+    }
+    
+    void flush() {
+        _writeMutex.lock();
+        _mutex.lock();
+        uint8_t* buf = _buffers[_active];
+        size_t len = _fill;
+        _active ^= 1;
+        _fill = 0;
+        _mutex.unlock();
+        
+        if (len > 0 && _out) _out->write(buf, len);
+        _writeMutex.unlock();
+    }
+    
+    static size_t putVarint(uint32_t v, uint8_t* out, size_t room) {
+        size_t n = 0;
+        while (n < room) {
+            uint8_t b = v & 0x7F;
+            v >>= 7;
+            out[n++] = v ? (b | 0x80) : b;
+            if (!v) return n;
+        }
+        return 0;  // Does not fit: nothing is kept
+    }
+    
+private:
+    static const size_t PREFIX_SIZE = 6;  // kind byte + varint time delta
+    
+    // Record kind and time since the previous record; caller holds _mutex
+    size_t putPrefix(Kind kind, uint32_t now, uint8_t (&prefix)[PREFIX_SIZE]) const {
+        prefix[0] = kind;
+        return 1 + putVarint(now - _lastUs, prefix + 1, PREFIX_SIZE - 1);
+    }
+    
+    std::atomic<bool> _recording{false};
+    Print* _out = nullptr;
+    DashboardMutex _mutex;       // guards the active buffer
+    DashboardMutex _writeMutex;  // serializes flush()
+    uint8_t* _buffers[2] = { nullptr, nullptr };
+    uint8_t _active = 0;
+    size_t _fill = 0;
+    unsigned long _fillStart = 0;
+    uint32_t _lastUs = 0;
+    std::atomic<uint32_t> _dropped{0};
+};
+
 /**
  * Card Group - Groups cards with a section title
  */
@@ -1054,6 +2545,10 @@ private:
     AsyncWebSocket* _ws;
     std::map<String, DashboardCard*> _cards;
     std::vector<CardGroup> _groups;
+    // Guards _cards, _groups and the cards themselves between loop(), the
+    // dashboard task and the network task
+    DashboardRecursiveMutex _cardMutex;
+    uint32_t _cardSerial = 0;
     String _title;
     String _subtitle;
     
@@ -1062,9 +2557,20 @@ private:
     size_t _otaSize;
     size_t _otaReceived;
     
-   // HTML data (for PROGMEM)
-   const uint8_t* _htmlData;
-   size_t _htmlSize;
+   // Web UI in PROGMEM: the page and, for a split build, its bundles
+   struct AssetETags {
+       char gzip[12];   // Quoted hash of the served bytes
+       char br[12];
+   };
+   const DashboardAsset* _assets = nullptr;
+   size_t _assetCount = 0;
+   AssetETags* _assetETags = nullptr;
+   DashboardAsset _page = {};   // Table of one for begin() with page data
+#if defined(ARDUINO_ARCH_ESP32)
+   // Web UI on a filesystem, preferred over PROGMEM when it has the file
+   fs::FS* _uiFS = nullptr;
+   String _uiDir;
+#endif
    
    // Heartbeat tracking
    unsigned long _lastHeartbeat;
@@ -1076,278 +2582,1347 @@ private:
    // Global command handler (for console tab)
    std::function<void(const String&)> _onCommand;
    
+   // Console messages below this level are dropped before formatting
+   LogLevel _minLogLevel = LogLevel::DEBUG;
+   
+   // Console subscription of one client: lines below minLevel are never sent to it,
+   // and if tags are given only lines carrying one of them are.
+   struct LogSubscription {
+       LogLevel minLevel = LogLevel::DEBUG;
+       uint8_t tagCount = 0;
+       uint32_t tags[DASHBOARD_LOG_MAX_TAGS];
+   };
+   
+   // Header of one line in the log batch, followed by jsonLen bytes of entry JSON
+   // and packLen bytes of the same entry as MessagePack
+   struct LogRecord {
+       uint8_t level;
+       uint32_t tagHash;  // 0 = untagged
+       uint16_t jsonLen;
+       uint16_t packLen;
+   } __attribute__((packed));
+   
+   // Outgoing console log batch: LogRecords of serialized entries, turned into one
+   // {type:"logs"} frame per distinct subscription and protocol on flush. Entries
+   // are serialized only in the formats the subscribed clients use (_logBatchFormats).
+   // Log calls can come from any task, so the batch, the subscriptions and the
+   // protocols of the clients are guarded by _logMutex.
+   DashboardMutex _logMutex;
+   std::map<uint32_t, LogSubscription> _logSubscriptions;  // by client id
+   std::vector<uint32_t> _msgpackClients;  // Clients that negotiated MessagePack
+   std::atomic<uint8_t> _msgpackClientCount{0};
+   uint8_t _logBatchFormats = 0;
+   std::atomic<uint8_t> _logSubscriberLevel{LOG_NO_SUBSCRIBERS};  // lowest level any client wants
+   char* _logBatch = nullptr;
+   char* _logFrame = nullptr;
+   size_t _logBatchLen = 0;
+   size_t _logBatchCount = 0;
+   unsigned long _logBatchStart = 0;
+   uint32_t _logFlushIntervalMs = 100;
+   
+   // Captured lines from other tasks (see enableLogCapture). Record: level, tag length, tag, message.
+   typedef MpscByteRing<DASHBOARD_LOG_CAPTURE_SIZE> LogCaptureRing;
+   LogCaptureRing* _logCapture = nullptr;
+   std::atomic<uint32_t> _droppedLogLines{0};
+#if defined(ARDUINO_ARCH_ESP32)
+   vprintf_like_t _prevVprintf = nullptr;
+   DashboardLogStore* _logStore = nullptr;
+#endif
+   
+   static const uint8_t LOG_NO_SUBSCRIBERS = 0xFF;
+   static const size_t LOG_FRAME_OVERHEAD = 32;  // {"type":"logs","entries":[ ... ]}
+   static const uint8_t LOG_FORMAT_JSON = 1;
+   static const uint8_t LOG_FORMAT_MSGPACK = 2;
+   
    // Firmware version info (for OTA tab)
    String _version;
    String _lastUpdate;
    
-   // WebSocket message reassembly buffer for fragmented frames
-   uint8_t* _wsBuffer = nullptr;
-   size_t _wsBufferSize = 0;
-   size_t _wsBufferFilled = 0;
+   // WebSocket message reassembly for fragmented frames, one slot per sending client.
+   // Buffers are allocated on first use and reused, so memory stays bounded by
+   // DASHBOARD_WS_REASSEMBLY_SLOTS * DASHBOARD_WS_MAX_MESSAGE_SIZE.
+   struct ReassemblySlot {
+       uint32_t clientId = 0;  // 0 = free (AsyncWebSocket ids start at 1)
+       size_t filled = 0;
+       bool discard = false;   // Message rejected, skip remaining fragments
+       uint32_t receivedUs = 0;  // micros() at the first fragment
+       uint8_t* buffer = nullptr;
+   };
+   ReassemblySlot _wsSlots[DASHBOARD_WS_REASSEMBLY_SLOTS];
+   
+   // Deferred actions: decoded by the network task, dispatched from loop()
+   enum class DeferredKind : uint8_t { INIT, ACTION, COMMAND };
+   
+   // Timing of one action from frame arrival to the end of its callback. traceId and
+   // clientTime come from the page and are echoed back in the ack (0 = untraced).
+   struct ActionTrace {
+       uint32_t traceId = 0;
+       uint32_t clientTime = 0;
+       uint32_t clientId = 0;
+       uint32_t receivedUs = 0;
+       uint32_t parsedUs = 0;
+   };
+   
+   struct DeferredAction {
+       DeferredKind kind;
+       uint32_t clientId;
+       ActionTrace trace;
+       uint32_t actionHash;
+       uint16_t cardIdLen;     // payload = card id + '\0' + action name + '\0' + MessagePack data
+       uint16_t actionLen;
+       uint16_t payloadLen;
+       uint8_t payload[DASHBOARD_ACTION_PAYLOAD_SIZE];
+   };
+   typedef SpscRing<DeferredAction, DASHBOARD_ACTION_QUEUE_SIZE> DeferredActionQueue;
+   DeferredActionQueue* _actionQueue = nullptr;
+   
+   // Updates published from other tasks, applied and coalesced in loop()
+   typedef DashboardUpdateKind UpdateKind;
+   struct UpdateRecord {
+       DashboardCard* card;
+       UpdateKind kind;
+       int8_t arg;             // Chart series index or stat decimals
+       union {
+           float f;
+           int32_t i;
+           bool b;
+       } value;
+       char text[DASHBOARD_UPDATE_TEXT_SIZE];
+       uint32_t serial;        // card->serial when published
+   };
+   typedef MpscQueue<UpdateRecord, DASHBOARD_UPDATE_QUEUE_SIZE> UpdateQueue;
+   UpdateQueue* _updateQueue = nullptr;
+   std::vector<DashboardCard*> _dirtyCards;
+   std::atomic<uint32_t> _droppedUpdates{0};
+   
+   // Prometheus /metrics: library metrics (enableMetricsEndpoints) and card values (enableCardMetrics)
+   bool _metricsHandlerRegistered = false;
+   bool _metricsEndpoints = false;
+   bool _cardMetrics = false;
+   String _cardMetricsPrefix;
+   
+#if DASHBOARD_METRICS
+   DashboardMetrics _metrics;
+   String _diagnosticsCardId;
+   unsigned long _lastDiagnostics = 0;
+   uint32_t _diagnosticsSent = 0;
+   uint32_t _diagnosticsReceived = 0;
+   LoopMonitor* _loopMonitor = nullptr;
+   String _loopCardId;
+   unsigned long _lastLoopCard = 0;
+#endif
+   bool _actionTracing = false;
+   
+   // Traffic recording (startRecording); kept until destruction once created
+   DashboardRecorder* _recorder = nullptr;
+   
+   // Dedicated dashboard task (beginTask)
+   bool _taskRunning = false;
+   uint32_t _taskPeriodMs = 10;
+   uint32_t _taskBudgetUs = 0;
+#if defined(ARDUINO_ARCH_ESP32)
+   TaskHandle_t _taskHandle = nullptr;
+#endif
+    
+    // Fields of an inbound message that are worth keeping; everything else
+    // (e.g. the OTA file name) is skipped by the parser without allocating.
+    static JsonDocument& messageFilter() {
+        static JsonDocument filter;
+        if (filter.isNull()) {
+            filter["type"] = true;
+            filter["cardId"] = true;
+            filter["action"] = true;
+            filter["data"] = true;
+            filter["command"] = true;
+            filter["size"] = true;
+            filter["level"] = true;
+            filter["tags"] = true;
+            filter["traceId"] = true;
+            filter["t"] = true;
+            filter["protocol"] = true;
+        }
+        return filter;
+    }
+    
+#if DASHBOARD_METRICS
+    static MetricMessage metricKind(uint32_t typeHash) {
+        switch (typeHash) {
+            case dashboardHash("init"): return MetricMessage::INIT;
+            case dashboardHash("action"): return MetricMessage::ACTION;
+            case dashboardHash("command"): return MetricMessage::COMMAND;
+            case dashboardHash("log_subscribe"): return MetricMessage::SUBSCRIBE;
+            case dashboardHash("ota_start"):
+            case dashboardHash("ota_chunk"):
+            case dashboardHash("ota_end"): return MetricMessage::OTA;
+            default: return MetricMessage::OTHER;
+        }
+    }
+#endif
     
     // Robust WebSocket JSON handler: parses exactly len bytes from data buffer
-    void handleWebSocketMessage(AsyncWebSocketClient* client, const uint8_t* data, size_t len) {
+    // receivedUs: micros() when the (first frame of the) message arrived, for action traces
+    void handleWebSocketMessage(AsyncWebSocketClient* client, const uint8_t* data, size_t len, uint32_t receivedUs) {
         if (len == 0 || data == nullptr) {
             // Ignore empty frames
             return;
         }
+        if (recording()) _recorder->frame(client->id(), data, len);
         
-        StaticJsonDocument<4096> doc;
+        DASHBOARD_METRIC(MetricTimer timer(_metrics.messageHandling));
+        
+        JsonDocument doc;
         // Explicitly cast to const char* to ensure correct ArduinoJson overload
-        DeserializationError error = deserializeJson(doc, (const char*)data, len);
+        DeserializationError error = deserializeJson(doc, (const char*)data, len,
+                                                     DeserializationOption::Filter(messageFilter()));
         
         if (error) {
             Serial.print("[Dashboard] JSON parse error: ");
             Serial.println(error.c_str());
             return;
         }
-      
-       String type = doc["type"].as<String>();
-        
-       if (type == "init") {
-           sendCardsToClient(client);
-       } else if (type == "action") {
-           String cardId = doc["cardId"].as<String>();
-           String action = doc["action"].as<String>();
-           JsonObject dataObj = doc["data"].as<JsonObject>();
-           
-           if (_cards.find(cardId) != _cards.end()) {
-               _cards[cardId]->handleAction(action, dataObj);
-               
-               // Handle OTA actions
-#if defined(ARDUINO_ARCH_ESP32)
-               if (action == "ota_start") {
-                   _otaSize = dataObj["size"].as<size_t>();
-                   _otaReceived = 0;
-                   _otaInProgress = true;
-                   
-                   if (!Update.begin(_otaSize)) {
-                       Serial.print("[Dashboard] OTA begin failed: ");
-                       Update.printError(Serial);
-                       _otaInProgress = false;
-                   }
-               } else if (action == "ota_chunk" && _otaInProgress) {
-                   String b64Data = dataObj["data"].as<String>();
-                   size_t expectedLen = base64_decode_length(b64Data);
-                   if (expectedLen == 0) {
-                       Serial.println("[Dashboard] OTA chunk: invalid base64 length");
-                       Update.abort();
-                       _otaInProgress = false;
-                       return;
-                   }
-                   uint8_t* decoded = new uint8_t[expectedLen];
-                   base64_decode(b64Data, decoded);
-                   
-                   size_t written = Update.write(decoded, expectedLen);
-                   if (written != expectedLen) {
-                       Serial.printf("[Dashboard] OTA write mismatch: expected %u, wrote %u\n", expectedLen, written);
-                       Update.abort();
-                       _otaInProgress = false;
-                       delete[] decoded;
-                       return;
-                   }
-                   _otaReceived += expectedLen;
-                   
-                   delete[] decoded;
-               } else if (action == "ota_end" && _otaInProgress) {
-                   if (_otaReceived != _otaSize) {
-                       Serial.printf("[Dashboard] OTA size mismatch! Expected %u, received %u\n", _otaSize, _otaReceived);
-                       Update.abort();
-                       _otaInProgress = false;
-                       return;
-                   }
-                   if (Update.end(true)) {
-                       Serial.println("[Dashboard] OTA complete, restarting...");
-                       delay(1000);
-                       ESP.restart();
-                   } else {
-                       Serial.println("[Dashboard] OTA end failed");
-                       Update.printError(Serial);
-                   }
-                   _otaInProgress = false;
-               }
-#else
-               if (action == "ota_start" || action == "ota_chunk" || action == "ota_end") {
-                   Serial.println("[Dashboard] OTA not supported on this platform");
-                   _otaInProgress = false;
-               }
-#endif
-           }
-       } else if (type == "command") {
-            // Global command from console tab
-            String command = doc["command"].as<String>();
-            if (_onCommand) {
-                _onCommand(command);
-            }
-       } else if (type == "ota_start" || type == "ota_chunk" || type == "ota_end") {
-           // Handle OTA from the dedicated OTA tab (not card-based)
-#if defined(ARDUINO_ARCH_ESP32)
-           if (type == "ota_start") {
-               _otaSize = doc["size"].as<size_t>();
-               _otaReceived = 0;
-               _otaInProgress = true;
-               
-               if (!Update.begin(_otaSize)) {
-                   Serial.print("[Dashboard] OTA begin failed: ");
-                   Update.printError(Serial);
-                   _otaInProgress = false;
-               }
-           } else if (type == "ota_chunk" && _otaInProgress) {
-               String b64Data = doc["data"].as<String>();
-               size_t expectedLen = base64_decode_length(b64Data);
-               if (expectedLen == 0) {
-                   Serial.println("[Dashboard] OTA chunk: invalid base64 length");
-                   Update.abort();
-                   _otaInProgress = false;
-                   return;
-               }
-               uint8_t* decoded = new uint8_t[expectedLen];
-               base64_decode(b64Data, decoded);
-               
-               size_t written = Update.write(decoded, expectedLen);
-               if (written != expectedLen) {
-                   Serial.printf("[Dashboard] OTA write mismatch: expected %u, wrote %u\n", expectedLen, written);
-                   Update.abort();
-                   _otaInProgress = false;
-                   delete[] decoded;
-                   return;
-               }
-               _otaReceived += expectedLen;
-               
-               delete[] decoded;
-           } else if (type == "ota_end" && _otaInProgress) {
-               if (_otaReceived != _otaSize) {
-                   Serial.printf("[Dashboard] OTA size mismatch! Expected %u, received %u\n", _otaSize, _otaReceived);
-                   Update.abort();
-                   _otaInProgress = false;
-                   return;
-               }
-               if (Update.end(true)) {
-                   Serial.println("[Dashboard] OTA complete, restarting...");
-                   delay(1000);
-                   ESP.restart();
-               } else {
-                   Serial.println("[Dashboard] OTA end failed");
-                   Update.printError(Serial);
-               }
-               _otaInProgress = false;
-           }
-#else
-           Serial.println("[Dashboard] OTA not supported on this platform");
-#endif
-       }
-   }
-     
-    void sendCardsToClient(AsyncWebSocketClient* client) {
-        DynamicJsonDocument doc(8192);
-        doc["type"] = "init";
-        doc["title"] = _title;
-        if (_subtitle.length() > 0) {
-            doc["subtitle"] = _subtitle;
-        }
-        doc["enableOTA"] = _enableOTA;
-        doc["enableConsole"] = _enableConsole;
-        
-        // Include version info for OTA tab
-        if (_version.length() > 0) {
-            doc["version"] = _version;
-        }
-        if (_lastUpdate.length() > 0) {
-            doc["lastUpdate"] = _lastUpdate;
-        }
+        uint32_t parsedUs = micros();
         
-        JsonArray cardsArray = doc.createNestedArray("cards");
-        
-        for (auto& pair : _cards) {
-            JsonObject card = cardsArray.createNestedObject();
-            pair.second->toJson(card);
-        }
+        const char* type = doc["type"] | "";
+        DASHBOARD_METRIC(_metrics.received(metricKind(dashboardHash(type)), len));
         
-        // Include groups
-        if (_groups.size() > 0) {
-            JsonArray groupsArray = doc.createNestedArray("groups");
-            for (const CardGroup& group : _groups) {
-                JsonObject groupObj = groupsArray.createNestedObject();
-                groupObj["id"] = group.id;
-                groupObj["title"] = group.title;
-                JsonArray cardIdsArr = groupObj.createNestedArray("cardIds");
-                for (const String& cardId : group.cardIds) {
-                    cardIdsArr.add(cardId);
+        switch (dashboardHash(type)) {
+            case dashboardHash("init"):
+#if DASHBOARD_MSGPACK
+                setClientProtocol(client->id(), strcmp(doc["protocol"] | "", "msgpack") == 0);
+#endif
+                if (_actionQueue) {
+                    deferInit(client->id());
+                } else {
+                    sendCardsToClient(client);
+                }
+                break;
+                
+            case dashboardHash("action"): {
+                const char* cardId = doc["cardId"] | "";
+                const char* action = doc["action"] | "";
+                JsonObject dataObj = doc["data"].as<JsonObject>();
+                
+                ActionTrace trace;
+                trace.traceId = doc["traceId"] | 0u;
+                trace.clientTime = doc["t"] | 0u;
+                trace.clientId = client->id();
+                trace.receivedUs = receivedUs;
+                trace.parsedUs = parsedUs;
+                
+                uint32_t actionHash = dashboardHash(action);
+                bool isOta = actionHash == dashboardHash("ota_start") ||
+                             actionHash == dashboardHash("ota_chunk") ||
+                             actionHash == dashboardHash("ota_end");
+                
+                // OTA stays on the network task: chunks must be written in order and are too big to queue
+                // Deferred actions carry the card id and are matched to a card when dispatched
+                if (_actionQueue && !isOta) {
+                    deferAction(cardId, actionHash, action, dataObj, trace);
+                    break;
                 }
+                if (!dispatchCardAction(cardId, actionHash, action, dataObj, trace)) break;
+                
+                // Handle OTA actions
+                switch (actionHash) {
+                    case dashboardHash("ota_start"):
+                        otaBegin(dataObj["size"].as<size_t>());
+                        break;
+                    case dashboardHash("ota_chunk"):
+                        otaWriteChunk(dataObj["data"].as<JsonString>());
+                        break;
+                    case dashboardHash("ota_end"):
+                        otaEnd();
+                        break;
+                }
+                break;
             }
+            
+            case dashboardHash("command"):
+                // Global command from console tab
+                if (_actionQueue) {
+                    deferCommand(doc["command"] | "");
+                } else if (_onCommand) {
+                    _onCommand(doc["command"].as<String>());
+                }
+                break;
+                
+            case dashboardHash("log_subscribe"):
+                // Console filter of this client, applied before lines are sent
+                subscribeLogs(client->id(), doc["level"] | "debug", doc["tags"].as<JsonArray>());
+                break;
+                
+            // Handle OTA from the dedicated OTA tab (not card-based)
+            case dashboardHash("ota_start"):
+                otaBegin(doc["size"].as<size_t>());
+                break;
+            case dashboardHash("ota_chunk"):
+                otaWriteChunk(doc["data"].as<JsonString>());
+                break;
+            case dashboardHash("ota_end"):
+                otaEnd();
+                break;
         }
-        
-        String output;
-        serializeJson(doc, output);
-        client->text(output);
     }
-     
-     // Base64 helpers
-     size_t base64_decode_length(const String& input) {
-         size_t len = input.length();
-         size_t padding = 0;
-         if (len >= 2) {
-             if (input[len - 1] == '=') padding++;
-             if (input[len - 2] == '=') padding++;
-         }
-         return (len * 3 / 4) - padding;
-     }
-     
-     void base64_decode(const String& input, uint8_t* output) {
-         static const char* b64chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-         size_t j = 0;
-         uint32_t buf = 0;
-         int bits = 0;
-         
-         for (size_t i = 0; i < input.length(); i++) {
-             char c = input[i];
-             if (c == '=') break;
-             
-             const char* p = strchr(b64chars, c);
-             if (!p) continue;
-             
-             buf = (buf << 6) | (p - b64chars);
-             bits += 6;
-             
-             if (bits >= 8) {
-                 bits -= 8;
-                 output[j++] = (buf >> bits) & 0xFF;
-            }
+    
+    // Deferred action producers (network task)
+    void deferInit(uint32_t clientId) {
+        DeferredAction* rec = _actionQueue->reserve();
+        if (!rec) {
+            Serial.println("[Dashboard] Action queue full, init dropped");
+            return;
         }
+        rec->kind = DeferredKind::INIT;
+        rec->clientId = clientId;
+        _actionQueue->commit();
     }
     
-    void sendHeartbeat() {
-        if (!_ws) return;
-        
-        // Send a minimal heartbeat message
+    void deferAction(const char* cardId, uint32_t actionHash, const char* action, JsonObject& data,
+                     const ActionTrace& trace) {
+        size_t cardIdLen = strlen(cardId);
+        size_t actionLen = strlen(action);
+        size_t dataLen = data.isNull() ? 0 : measureMsgPack(data);
+        if (cardIdLen + 1 + actionLen + 1 + dataLen > DASHBOARD_ACTION_PAYLOAD_SIZE) {
+            Serial.printf("[Dashboard] Action '%s' too large to queue, dropped\n", action);
+            return;
+        }
+        DeferredAction* rec = _actionQueue->reserve();
+        if (!rec) {
+            Serial.println("[Dashboard] Action queue full, action dropped");
+            return;
+        }
+        rec->kind = DeferredKind::ACTION;
+        rec->clientId = trace.clientId;
+        rec->trace = trace;
+        rec->actionHash = actionHash;
+        rec->cardIdLen = cardIdLen;
+        rec->actionLen = actionLen;
+        memcpy(rec->payload, cardId, cardIdLen + 1);
+        memcpy(rec->payload + cardIdLen + 1, action, actionLen + 1);
+        rec->payloadLen = cardIdLen + 1 + actionLen + 1;
+        if (dataLen > 0) {
+            rec->payloadLen += serializeMsgPack(data, rec->payload + rec->payloadLen, dataLen);
+        }
+        _actionQueue->commit();
+    }
+    
+    void deferCommand(const char* command) {
+        size_t len = strlen(command);
+        if (len + 1 > DASHBOARD_ACTION_PAYLOAD_SIZE) {
+            Serial.println("[Dashboard] Command too long to queue, dropped");
+            return;
+        }
+        DeferredAction* rec = _actionQueue->reserve();
+        if (!rec) {
+            Serial.println("[Dashboard] Action queue full, command dropped");
+            return;
+        }
+        rec->kind = DeferredKind::COMMAND;
+        memcpy(rec->payload, command, len + 1);
+        rec->payloadLen = len + 1;
+        _actionQueue->commit();
+    }
+    
+#if DASHBOARD_METRICS
+    // One group of library metric lines; false once past the last group. Split up so
+    // that /metrics can stream them without holding the whole text in memory.
+    bool printMetricsPart(Print& out, size_t part) {
+        switch (part) {
+            case 0:
+                out.print("# TYPE dashboard_messages_sent_total counter\n");
+                for (size_t k = 0; k < DashboardMetrics::KINDS; k++) {
+                    out.printf("dashboard_messages_sent_total{type=\"%s\"} %lu\n",
+                               DashboardMetrics::messageName(k), (unsigned long)_metrics.sentMessages(k));
+                }
+                return true;
+            case 1:
+                out.print("# TYPE dashboard_bytes_sent_total counter\n");
+                for (size_t k = 0; k < DashboardMetrics::KINDS; k++) {
+                    out.printf("dashboard_bytes_sent_total{type=\"%s\"} %lu\n",
+                               DashboardMetrics::messageName(k), (unsigned long)_metrics.sentBytes(k));
+                }
+                return true;
+            case 2:
+                out.print("# TYPE dashboard_messages_received_total counter\n");
+                for (size_t k = 0; k < DashboardMetrics::KINDS; k++) {
+                    out.printf("dashboard_messages_received_total{type=\"%s\"} %lu\n",
+                               DashboardMetrics::messageName(k), (unsigned long)_metrics.receivedMessages(k));
+                }
+                return true;
+            case 3:
+                out.print("# TYPE dashboard_bytes_received_total counter\n");
+                for (size_t k = 0; k < DashboardMetrics::KINDS; k++) {
+                    out.printf("dashboard_bytes_received_total{type=\"%s\"} %lu\n",
+                               DashboardMetrics::messageName(k), (unsigned long)_metrics.receivedBytes(k));
+                }
+                return true;
+            case 4:
+                _metrics.initSerialize.printPrometheus(out, "dashboard_init_serialize_microseconds");
+                return true;
+            case 5:
+                _metrics.updateSerialize.printPrometheus(out, "dashboard_update_serialize_microseconds");
+                return true;
+            case 6:
+                _metrics.messageHandling.printPrometheus(out, "dashboard_message_handling_microseconds");
+                return true;
+            case 7:
+                out.printf("# TYPE dashboard_updates_dropped_total counter\ndashboard_updates_dropped_total %lu\n",
+                           (unsigned long)getDroppedUpdates());
+                out.printf("# TYPE dashboard_updates_coalesced_total counter\ndashboard_updates_coalesced_total %lu\n",
+                           (unsigned long)_metrics.coalescedUpdates.load(std::memory_order_relaxed));
+                out.printf("# TYPE dashboard_log_lines_dropped_total counter\ndashboard_log_lines_dropped_total %lu\n",
+                           (unsigned long)getDroppedLogLines());
+                out.printf("# TYPE dashboard_ota_bytes gauge\ndashboard_ota_bytes %lu\n",
+                           (unsigned long)_metrics.otaBytes());
+                out.printf("# TYPE dashboard_ota_bytes_per_second gauge\ndashboard_ota_bytes_per_second %lu\n",
+                           (unsigned long)_metrics.otaBytesPerSecond());
+                return true;
+            case 8: {
+                out.print("# TYPE dashboard_client_queue_length gauge\n");
+                size_t clients = 0;
+                if (_ws) {
+                    for (AsyncWebSocketClient& client : _ws->getClients()) {
+                        if (client.status() != WS_CONNECTED) continue;
+                        out.printf("dashboard_client_queue_length{client=\"%lu\"} %lu\n",
+                                   (unsigned long)client.id(), (unsigned long)client.queueLen());
+                        clients++;
+                    }
+                }
+                out.printf("# TYPE dashboard_clients gauge\ndashboard_clients %lu\n", (unsigned long)clients);
+                return true;
+            }
+            case 9:
+                out.printf("# TYPE dashboard_heap_free_bytes gauge\ndashboard_heap_free_bytes %lu\n",
+                           (unsigned long)ESP.getFreeHeap());
+                out.printf("# TYPE dashboard_heap_largest_free_block_bytes gauge\ndashboard_heap_largest_free_block_bytes %lu\n",
+                           (unsigned long)largestFreeBlock());
+                out.printf("# TYPE dashboard_uptime_seconds gauge\ndashboard_uptime_seconds %lu\n",
+                           (unsigned long)(millis() / 1000));
+                return true;
+            case 10:
+                if (_loopMonitor) printLoopMetrics(out);
+                return true;
+            case 11:
+                // Samples follow per card, see printActionLatency(); must stay the last part
+                out.print("# TYPE dashboard_action_latency_microseconds histogram\n");
+                return true;
+            default:
+                return false;
+        }
+    }
+    
+    void printLoopMetrics(Print& out) {
+        const LoopTimingSeries* series[2] = { &_loopMonitor->interval, &_loopMonitor->busy };
+        const char* names[2] = { "dashboard_loop_interval_microseconds", "dashboard_loop_busy_microseconds" };
+        for (size_t i = 0; i < 2; i++) {
+            LoopTimingStats s = series[i]->stats();
+            out.printf("# TYPE %s gauge\n", names[i]);
+            out.printf("%s{stat=\"min\"} %lu\n", names[i], (unsigned long)s.min);
+            out.printf("%s{stat=\"avg\"} %lu\n", names[i], (unsigned long)s.avg);
+            out.printf("%s{stat=\"p99\"} %lu\n", names[i], (unsigned long)s.p99);
+            out.printf("%s{stat=\"max\"} %lu\n", names[i], (unsigned long)s.max);
+        }
+        out.printf("# TYPE dashboard_loop_cpu_share gauge\ndashboard_loop_cpu_share %.4f\n", _loopMonitor->cpuShare());
+        if (_loopMonitor->stackHighWater() > 0) {
+            out.printf("# TYPE dashboard_stack_free_bytes gauge\ndashboard_stack_free_bytes %lu\n",
+                       (unsigned long)_loopMonitor->stackHighWater());
+        }
+    }
+    
+    // Action latency samples of one card, nothing before its first action
+    void printActionLatency(Print& out, DashboardCard* card) {
+        MetricHistogram* histogram = card->actionLatency.load(std::memory_order_acquire);
+        if (!histogram) return;
+        // The whole id, escaped: a cut id could turn two cards into one series
+        String labels = "card=\"";
+        for (const char* c = card->id.c_str(); *c; c++) {
+            if (*c == '\\') labels += "\\\\";
+            else if (*c == '"') labels += "\\\"";
+            else if (*c == '\n') labels += "\\n";
+            else labels += *c;
+        }
+        labels += '"';
+        histogram->printPrometheusSamples(out, "dashboard_action_latency_microseconds", labels.c_str());
+    }
+    
+    static uint32_t largestFreeBlock() {
+#if defined(ARDUINO_ARCH_ESP8266)
+        return ESP.getMaxFreeBlockSize();
+#else
+        return ESP.getMaxAllocHeap();
+#endif
+    }
+    
+    void updateDiagnosticsCard() {
+        unsigned long now = millis();
+        uint32_t sent = 0;
+        uint32_t received = 0;
+        for (size_t k = 0; k < DashboardMetrics::KINDS; k++) {
+            sent += _metrics.sentMessages(k);
+            received += _metrics.receivedMessages(k);
+        }
+        float seconds = (now - _lastDiagnostics) / 1000.0f;
+        float txRate = (sent - _diagnosticsSent) / seconds;
+        float rxRate = (received - _diagnosticsReceived) / seconds;
+        _diagnosticsSent = sent;
+        _diagnosticsReceived = received;
+        _lastDiagnostics = now;
+        
+        uint32_t freeHeap = ESP.getFreeHeap();
+        uint32_t block = largestFreeBlock();
+        uint32_t dropped = getDroppedUpdates() + getDroppedLogLines();
+        
+        char label[64];
+        snprintf(label, sizeof(label), "Heap %lu KB free, largest block %lu KB",
+                 (unsigned long)(freeHeap / 1024), (unsigned long)(block / 1024));
+        char message[128];
+        snprintf(message, sizeof(message), "TX %.1f msg/s, RX %.1f msg/s, handler p99 <= %lu us, dropped %lu",
+                 txRate, rxRate, (unsigned long)_metrics.messageHandling.quantile(0.99f), (unsigned long)dropped);
+        
+        bool healthy = block >= 16 * 1024 && dropped == 0;
+        updateStatusCard(_diagnosticsCardId, healthy ? StatusIcon::CHECK : StatusIcon::WARNING,
+                         healthy ? CardVariant::SUCCESS : CardVariant::WARNING, label, message);
+    }
+    
+    static void loopStatsToJson(JsonObject obj, const LoopTimingStats& s) {
+        obj["count"] = s.count;
+        obj["min"] = s.min;
+        obj["avg"] = s.avg;
+        obj["p99"] = s.p99;
+        obj["max"] = s.max;
+    }
+    
+    void updateLoopMonitorCard() {
+        _lastLoopCard = millis();
+        LoopTimingStats interval = _loopMonitor->interval.stats();
+        LoopTimingStats busy = _loopMonitor->busy.stats();
+        if (interval.count == 0) return;  // First window still open
+        float share = _loopMonitor->cpuShare() * 100.0f;
+        
+        char label[80];
+        snprintf(label, sizeof(label), "Interval avg %lu us, p99 <= %lu us, max %lu us",
+                 (unsigned long)interval.avg, (unsigned long)interval.p99, (unsigned long)interval.max);
+        char message[128];
+        int len = snprintf(message, sizeof(message), "Dashboard avg %lu us, p99 <= %lu us, max %lu us, %.1f%% CPU",
+                           (unsigned long)busy.avg, (unsigned long)busy.p99, (unsigned long)busy.max, share);
+        uint32_t stack = _loopMonitor->stackHighWater();
+        if (stack > 0 && len > 0 && (size_t)len < sizeof(message)) {
+            snprintf(message + len, sizeof(message) - len, ", stack %lu B free", (unsigned long)stack);
+        }
+        
+        bool healthy = share < 10.0f && (stack == 0 || stack >= 1024);
+        updateStatusCard(_loopCardId, healthy ? StatusIcon::CHECK : StatusIcon::WARNING,
+                         healthy ? CardVariant::SUCCESS : CardVariant::WARNING, label, message);
+    }
+#endif
+    
+    // Print into a fixed buffer; output past the end is dropped
+    class BufferPrint : public Print {
+    public:
+        BufferPrint(char* buffer, size_t size) : _buffer(buffer), _size(size) {}
+        size_t write(uint8_t c) override {
+            if (_len >= _size) return 0;
+            _buffer[_len++] = (char)c;
+            return 1;
+        }
+        size_t write(const uint8_t* data, size_t len) override {
+            size_t n = std::min(len, _size - _len);
+            memcpy(_buffer + _len, data, n);
+            _len += n;
+            return n;
+        }
+        size_t length() const { return _len; }
+    private:
+        char* _buffer;
+        size_t _size;
+        size_t _len = 0;
+    };
+    
+    // Position of one /metrics response: the next library metrics part, then the
+    // card after lastCardId, once for action latencies and once for card values.
+    // One rendered item waits in item[] until it is sent.
+    struct MetricsCursor {
+        bool library = false;  // Library metrics first (enableMetricsEndpoints())
+        size_t part = 0;
+        bool latencyDone = false;
+        bool cardsStarted = false;
+        String lastCardId;
+        char item[DASHBOARD_METRICS_ITEM_SIZE];
+        size_t itemLen = 0;
+        size_t itemPos = 0;
+    };
+    
+    void registerMetricsHandler() {
+        if (_metricsHandlerRegistered || !_server) return;
+        _metricsHandlerRegistered = true;
+        _server->on("/metrics", HTTP_GET, [this](AsyncWebServerRequest* request) {
+            std::shared_ptr<MetricsCursor> cursor = std::make_shared<MetricsCursor>();
+            cursor->library = _metricsEndpoints;
+            AsyncWebServerResponse* response = request->beginChunkedResponse("text/plain; version=0.0.4",
+                [this, cursor](uint8_t* buffer, size_t maxLen, size_t) -> size_t {
+                    size_t out = 0;
+                    while (out < maxLen) {
+                        if (cursor->itemPos == cursor->itemLen && !renderMetricsItem(*cursor)) break;
+                        size_t n = std::min(maxLen - out, cursor->itemLen - cursor->itemPos);
+                        memcpy(buffer + out, cursor->item + cursor->itemPos, n);
+                        cursor->itemPos += n;
+                        out += n;
+                    }
+                    return out;
+                });
+            request->send(response);
+        });
+    }
+    
+    // Render the next non-empty item into cursor.item; false when the response is complete
+    bool renderMetricsItem(MetricsCursor& cursor) {
+        DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
+        for (;;) {
+            BufferPrint out(cursor.item, sizeof(cursor.item));
+#if DASHBOARD_METRICS
+            if (cursor.library && printMetricsPart(out, cursor.part)) {
+                cursor.part++;
+            } else if (cursor.library && !cursor.latencyDone) {
+                auto it = cursor.cardsStarted ? _cards.upper_bound(cursor.lastCardId) : _cards.begin();
+                if (it == _cards.end()) {
+                    cursor.latencyDone = true;
+                    cursor.cardsStarted = false;
+                    continue;
+                }
+                cursor.cardsStarted = true;
+                cursor.lastCardId = it->first;
+                printActionLatency(out, it->second);
+            } else
+#endif
+            {
+                if (!_cardMetrics) return false;
+                auto it = cursor.cardsStarted ? _cards.upper_bound(cursor.lastCardId) : _cards.begin();
+                if (it == _cards.end()) return false;
+                cursor.cardsStarted = true;
+                cursor.lastCardId = it->first;
+                printCardMetric(out, it->second);
+            }
+            cursor.itemLen = out.length();
+            cursor.itemPos = 0;
+            if (cursor.itemLen > 0) return true;
+        }
+    }
+    
+    // Prometheus lines for one card, nothing for cards without a numeric value.
+    // Cards whose ids map to the same metric name share one HELP/TYPE block and
+    // are told apart by a card="..." label.
+    void printCardMetric(Print& out, DashboardCard* card) {
+        double value = 0;
+        if (!cardMetricValue(card, value)) return;
+        char name[64];
+        cardMetricName(card->id, name);
+        
+        bool shared = false;
+        bool first = true;
+        for (auto& kv : _cards) {
+            double otherValue;
+            char other[64];
+            if (kv.second == card || !cardMetricValue(kv.second, otherValue)) continue;
+            cardMetricName(kv.first, other);
+            if (strcmp(name, other) != 0) continue;
+            shared = true;
+            if (kv.first < card->id) first = false;
+        }
+        
+        const char* group = nullptr;
+        for (const CardGroup& g : _groups) {
+            if (std::find(g.cardIds.begin(), g.cardIds.end(), card->id) != g.cardIds.end()) {
+                group = g.id.c_str();
+                break;
+            }
+        }
+        const char* cardLabel = shared ? card->id.c_str() : nullptr;
+        
+        if (first) {
+            out.print("# HELP ");
+            out.print(name);
+            out.print(' ');
+            for (const char* c = card->title.c_str(); *c; c++) {
+                if (*c == '\\') out.print("\\\\");
+                else if (*c == '\n') out.print("\\n");
+                else out.print(*c);
+            }
+            out.printf("\n# TYPE %s gauge\n", name);
+        }
+        
+        if (card->type != CardType::CHART) {
+            printCardSample(out, name, group, cardLabel, nullptr, value);
+            return;
+        }
+        
+        ChartCard* chart = static_cast<ChartCard*>(card);
+        if (chart->series.empty()) {
+            if (!chart->data.empty()) printCardSample(out, name, group, cardLabel, nullptr, chart->data.back());
+            return;
+        }
+        for (const ChartSeries& s : chart->series) {
+            if (!s.data.empty()) printCardSample(out, name, group, cardLabel, s.name.c_str(), s.data.back());
+        }
+    }
+    
+    // Current value of a card for /metrics; false for cards without a numeric value.
+    // Charts always qualify, their samples are the latest points.
+    static bool cardMetricValue(DashboardCard* card, double& value) {
+        switch (card->type) {
+            case CardType::STAT: {
+                const String& text = static_cast<StatCard*>(card)->value;
+                char* end;
+                value = strtod(text.c_str(), &end);
+                return end != text.c_str() && *end == '\0';
+            }
+            case CardType::GAUGE: value = static_cast<GaugeCard*>(card)->value; return true;
+            case CardType::SLIDER: value = static_cast<SliderCard*>(card)->value; return true;
+            case CardType::TOGGLE: value = static_cast<ToggleCard*>(card)->value ? 1 : 0; return true;
+            case CardType::CHART: return true;
+            default: return false;
+        }
+    }
+    
+    // Metric name: prefix_cardid with anything outside [a-zA-Z0-9_] replaced by '_',
+    // cut to the buffer size
+    void cardMetricName(const String& id, char (&name)[64]) {
+        if (snprintf(name, sizeof(name), "%s_%s", _cardMetricsPrefix.c_str(), id.c_str()) < 0) name[0] = '\0';
+        for (char* c = name; *c; c++) {
+            if (!isalnum((unsigned char)*c) && *c != '_') *c = '_';
+        }
+        if (isdigit((unsigned char)name[0])) name[0] = '_';
+    }
+    
+    static void printCardSample(Print& out, const char* name, const char* group, const char* cardId,
+                                const char* series, double value) {
+        out.print(name);
+        char sep = '{';
+        const char* keys[] = {"group", "card", "series"};
+        const char* values[] = {group, cardId, series};
+        for (size_t i = 0; i < 3; i++) {
+            if (!values[i]) continue;
+            out.print(sep);
+            out.print(keys[i]);
+            out.print("=\"");
+            printLabelValue(out, values[i]);
+            out.print('"');
+            sep = ',';
+        }
+        if (sep == ',') out.print('}');
+        out.printf(" %.9g\n", value);
+    }
+    
+    // Label value with backslash, double quote and newline escaped
+    static void printLabelValue(Print& out, const char* value) {
+        for (const char* c = value; *c; c++) {
+            if (*c == '\\') out.print("\\\\");
+            else if (*c == '"') out.print("\\\"");
+            else if (*c == '\n') out.print("\\n");
+            else out.print(*c);
+        }
+    }
+    
+    // True once budgetUs microseconds have passed since start (0 = no budget)
+    static bool budgetExceeded(uint32_t start, uint32_t budgetUs) {
+        return budgetUs > 0 && (uint32_t)(micros() - start) >= budgetUs;
+    }
+    
+    // Deferred action consumer (loop task). Handles at most one queue's worth per call
+    // so a flooding client cannot starve the application loop.
+    void processDeferredActions(uint32_t start, uint32_t budgetUs) {
+        for (size_t n = 0; n < DASHBOARD_ACTION_QUEUE_SIZE && !budgetExceeded(start, budgetUs); n++) {
+            DeferredAction* rec = _actionQueue->front();
+            if (!rec) break;
+            
+            switch (rec->kind) {
+                case DeferredKind::INIT: {
+                    AsyncWebSocketClient* client = _ws ? _ws->client(rec->clientId) : nullptr;
+                    if (client) sendCardsToClient(client);
+                    break;
+                }
+                case DeferredKind::ACTION: {
+                    const char* action = (const char*)rec->payload + rec->cardIdLen + 1;
+                    JsonDocument doc;
+                    size_t dataOffset = rec->cardIdLen + 1 + rec->actionLen + 1;
+                    if (rec->payloadLen > dataOffset) {
+                        deserializeMsgPack(doc, rec->payload + dataOffset, rec->payloadLen - dataOffset);
+                    }
+                    JsonObject data = doc.as<JsonObject>();
+                    // The card may have been removed since the action was queued
+                    dispatchCardAction((const char*)rec->payload, rec->actionHash, action, data, rec->trace);
+                    break;
+                }
+                case DeferredKind::COMMAND:
+                    if (_onCommand) _onCommand(String((const char*)rec->payload));
+                    break;
+            }
+            _actionQueue->pop();
+        }
+    }
+    
+    // Run a card's action callback without holding the card lock, so user code never
+    // stalls the other tasks. The card is pinned meanwhile: if it is removed, the last
+    // callback running on it deletes it. False if there is no such card.
+    bool dispatchCardAction(const char* cardId, uint32_t actionHash, const char* action, JsonObject& data,
+                            const ActionTrace& trace) {
+        DashboardCard* card;
+        {
+            DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
+            auto it = _cards.find(cardId);
+            if (it == _cards.end()) return false;
+            card = it->second;
+            card->dispatching++;
+        }
+        uint32_t callbackStartUs = micros();
+        card->dispatchAction(actionHash, action, data);
+        uint32_t callbackEndUs = micros();
+        
+        DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
+        finishActionTrace(card, trace, callbackStartUs, callbackEndUs);
+        if (--card->dispatching == 0 && card->removed) delete card;
+        return true;
+    }
+    
+    // Record an action's device-side latency on its card and, when tracing is on and the
+    // page sent a trace id, echo the stamps back so the page can split up the round trip
+    void finishActionTrace(DashboardCard* card, const ActionTrace& trace, uint32_t callbackStartUs, uint32_t callbackEndUs) {
+#if DASHBOARD_METRICS
+        MetricHistogram* histogram = card->actionLatency.load(std::memory_order_acquire);
+        if (!histogram) {
+            // Installed once even if two tasks record a first action together
+            MetricHistogram* fresh = new MetricHistogram();
+            if (card->actionLatency.compare_exchange_strong(histogram, fresh, std::memory_order_acq_rel,
+                                                            std::memory_order_acquire)) {
+                histogram = fresh;
+            } else {
+                delete fresh;
+            }
+        }
+        histogram->record(callbackEndUs - trace.receivedUs);
+#endif
+        if (!_actionTracing || trace.traceId == 0 || !_ws) return;
+        AsyncWebSocketClient* client = _ws->client(trace.clientId);
+        if (!client) return;
+        
+        JsonDocument doc;
+        doc["type"] = "ack";
+        doc["traceId"] = trace.traceId;
+        doc["t"] = trace.clientTime;
+        doc["cardId"] = card->id;
+        doc["receivedUs"] = trace.receivedUs;
+        doc["parsedUs"] = trace.parsedUs;
+        doc["callbackStartUs"] = callbackStartUs;
+        doc["callbackEndUs"] = callbackEndUs;
+        
+        String output;
+        serializeJson(doc, output);
+        client->text(output);
+        DASHBOARD_METRIC(_metrics.sent(MetricMessage::ACK, output.length()));
+    }
+    
+    bool queueUpdate(UpdateRecord rec) {
+        rec.serial = rec.card->serial;
+        if (recording()) {
+            int32_t value;
+            memcpy(&value, &rec.value, sizeof(value));
+            _recorder->entry(DashboardRecorder::PUBLISH).u8((uint8_t)rec.kind).str(rec.card->id)
+                .u8((uint8_t)rec.arg).i32(value).str(rec.text, strnlen(rec.text, sizeof(rec.text)));
+        }
+        if (!_updateQueue || !_updateQueue->push(rec)) {
+            _droppedUpdates.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+    
+    // Apply published updates to card state, then send one update per touched card.
+    // Cards not flushed within the budget stay dirty until the next call.
+    void processPublishedUpdates(uint32_t start, uint32_t budgetUs) {
+        UpdateRecord rec;
+        for (size_t n = 0; n < DASHBOARD_UPDATE_QUEUE_SIZE && !budgetExceeded(start, budgetUs) &&
+                           _updateQueue->pop(rec); n++) {
+            if (!hasCard(rec.card, rec.serial)) continue;
+            
+            switch (rec.kind) {
+                case UpdateKind::STAT_TEXT:
+                    static_cast<StatCard*>(rec.card)->setValue(rec.text);
+                    break;
+                case UpdateKind::STAT_NUMBER:
+                    static_cast<StatCard*>(rec.card)->setValue(String(rec.value.f, (unsigned int)rec.arg));
+                    break;
+                case UpdateKind::GAUGE:
+                    static_cast<GaugeCard*>(rec.card)->setValue(rec.value.f);
+                    break;
+                case UpdateKind::CHART:
+                    static_cast<ChartCard*>(rec.card)->addDataPoint(rec.value.f);
+                    break;
+                case UpdateKind::CHART_SERIES:
+                    static_cast<ChartCard*>(rec.card)->addDataPoint(rec.arg, rec.value.f);
+                    break;
+                case UpdateKind::TOGGLE:
+                    static_cast<ToggleCard*>(rec.card)->setValue(rec.value.b);
+                    break;
+                case UpdateKind::SLIDER:
+                    static_cast<SliderCard*>(rec.card)->setValue(rec.value.i);
+                    break;
+            }
+            
+            if (std::find(_dirtyCards.begin(), _dirtyCards.end(), rec.card) == _dirtyCards.end()) {
+                _dirtyCards.push_back(rec.card);
+            } else {
+                DASHBOARD_METRIC(_metrics.coalescedUpdates.fetch_add(1, std::memory_order_relaxed));
+            }
+        }
+        
+        size_t flushed = 0;
+        while (flushed < _dirtyCards.size() && (flushed == 0 || !budgetExceeded(start, budgetUs))) {
+            // removeCard() takes removed cards off this list
+            broadcastCardState(_dirtyCards[flushed]);
+            flushed++;
+        }
+        _dirtyCards.erase(_dirtyCards.begin(), _dirtyCards.begin() + flushed);
+    }
+    
+    // One pass of dashboard housekeeping. Queue draining stops once budgetUs is used up
+    // (0 = unlimited); client cleanup and heartbeats always run. The card lock is only
+    // held for the steps that touch cards, never across callbacks or flash writes.
+    void service(uint32_t budgetUs) {
+        uint32_t start = micros();
+#if DASHBOARD_METRICS
+        if (_loopMonitor) _loopMonitor->passStarted(start);
+#endif
+        
+        if (_actionQueue) {
+            processDeferredActions(start, budgetUs);
+        }
+        
+        if (_updateQueue) {
+            DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
+            processPublishedUpdates(start, budgetUs);
+        }
+        
+        if (_logCapture) {
+            drainCapturedLogs(start, budgetUs);
+        }
+        
+        // Lines are batched from any task, so the batch is only looked at under the lock
+        _logMutex.lock();
+        if (_logBatchCount > 0 && millis() - _logBatchStart >= _logFlushIntervalMs) {
+            flushLogBatchLocked();
+        }
+        _logMutex.unlock();
+        
+#if defined(ARDUINO_ARCH_ESP32)
+        if (_logStore && _logStore->needsFlush()) {
+            _logStore->flush();
+        }
+#endif
+        
+        if (_recorder && _recorder->needsFlush()) {
+            _recorder->flush();
+        }
+        
+        if (_ws) {
+            _ws->cleanupClients();
+            
+            // Send heartbeat every 2.5 seconds
+            unsigned long now = millis();
+            if (now - _lastHeartbeat >= 2500) {
+                sendHeartbeat();
+                _lastHeartbeat = now;
+            }
+        }
+        
+#if DASHBOARD_METRICS
+        if (_diagnosticsCardId.length() > 0 && millis() - _lastDiagnostics >= 2000) {
+            updateDiagnosticsCard();
+        }
+        if (_loopCardId.length() > 0 && millis() - _lastLoopCard >= 2000) {
+            updateLoopMonitorCard();
+        }
+        if (_loopMonitor) _loopMonitor->passEnded(micros());
+#endif
+    }
+    
+#if defined(ARDUINO_ARCH_ESP32)
+    static void taskEntry(void* arg) {
+        ESPDashboardPlus* self = static_cast<ESPDashboardPlus*>(arg);
+        TickType_t period = pdMS_TO_TICKS(self->_taskPeriodMs);
+        if (period == 0) period = 1;
+        TickType_t lastWake = xTaskGetTickCount();
+        for (;;) {
+            self->service(self->_taskBudgetUs);
+            vTaskDelayUntil(&lastWake, period);
+        }
+    }
+#endif
+    
+    // Send the current value of a card as an update message
+    void broadcastCardState(DashboardCard* card) {
+        JsonDocument doc;
+        JsonObject data = doc.to<JsonObject>();
+        
+        switch (card->type) {
+            case CardType::STAT:
+                data["value"] = static_cast<StatCard*>(card)->value;
+                break;
+            case CardType::GAUGE:
+                data["value"] = static_cast<GaugeCard*>(card)->value;
+                break;
+            case CardType::TOGGLE:
+                data["value"] = static_cast<ToggleCard*>(card)->value;
+                break;
+            case CardType::SLIDER:
+                data["value"] = static_cast<SliderCard*>(card)->value;
+                break;
+            case CardType::CHART: {
+                ChartCard* chart = static_cast<ChartCard*>(card);
+                if (chart->series.size() > 0) {
+                    JsonArray seriesArr = data["series"].to<JsonArray>();
+                    for (const ChartSeries& s : chart->series) {
+                        JsonObject seriesObj = seriesArr.add<JsonObject>();
+                        seriesObj["name"] = s.name;
+                        seriesObj["color"] = s.color;
+                        JsonArray dataArr = seriesObj["data"].to<JsonArray>();
+                        for (float v : s.data) {
+                            dataArr.add(v);
+                        }
+                    }
+                } else {
+                    JsonArray dataArr = data["data"].to<JsonArray>();
+                    for (float v : chart->data) {
+                        dataArr.add(v);
+                    }
+                }
+                break;
+            }
+            default:
+                return;
+        }
+        broadcastUpdate(card->id, data);
+    }
+    
+    void putCard(const String& id, DashboardCard* card) {
+        DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
+        card->serial = ++_cardSerial;
+        _cards[id] = card;
+    }
+    
+    // True if card is still on the dashboard and is the one that had this serial;
+    // the pointer alone may belong to a new card allocated at the same address
+    bool hasCard(DashboardCard* card, uint32_t serial) {
+        for (auto& pair : _cards) {
+            if (pair.second == card) return card->serial == serial;
+        }
+        return false;
+    }
+    
+    // OTA helpers shared by the OTA tab and OTA cards
+    void otaBegin(size_t size) {
+#if DASHBOARD_OTA_UPDATE
+        _otaSize = size;
+        _otaReceived = 0;
+        _otaInProgress = true;
+        DASHBOARD_METRIC(_metrics.otaStarted());
+        
+        if (!Update.begin(_otaSize)) {
+            Serial.print("[Dashboard] OTA begin failed: ");
+            Update.printError(Serial);
+            _otaInProgress = false;
+        }
+#else
+        Serial.println("[Dashboard] OTA not supported on this platform");
+        _otaInProgress = false;
+#endif
+    }
+    
+    void otaWriteChunk(JsonString b64Data) {
+        if (!_otaInProgress) return;
+#if DASHBOARD_OTA_UPDATE
+        size_t expectedLen = dashboardBase64DecodedLength(b64Data.c_str(), b64Data.size());
+        if (expectedLen == 0) {
+            Serial.println("[Dashboard] OTA chunk: invalid base64 length");
+            Update.abort();
+            _otaInProgress = false;
+            return;
+        }
+        uint8_t* decoded = new uint8_t[expectedLen];
+        dashboardBase64Decode(b64Data.c_str(), b64Data.size(), decoded);
+        
+        size_t written = Update.write(decoded, expectedLen);
+        delete[] decoded;
+        if (written != expectedLen) {
+            Serial.printf("[Dashboard] OTA write mismatch: expected %u, wrote %u\n",
+                          (unsigned)expectedLen, (unsigned)written);
+            Update.abort();
+            _otaInProgress = false;
+            return;
+        }
+        _otaReceived += expectedLen;
+        DASHBOARD_METRIC(_metrics.otaWritten(expectedLen));
+#endif
+    }
+    
+    void otaEnd() {
+        if (!_otaInProgress) return;
+#if DASHBOARD_OTA_UPDATE
+        if (_otaReceived != _otaSize) {
+            Serial.printf("[Dashboard] OTA size mismatch! Expected %u, received %u\n",
+                          (unsigned)_otaSize, (unsigned)_otaReceived);
+            Update.abort();
+            _otaInProgress = false;
+            return;
+        }
+        if (Update.end(true)) {
+            Serial.println("[Dashboard] OTA complete, restarting...");
+#if defined(ARDUINO_ARCH_ESP32)
+            flushLogStore();
+#endif
+            delay(1000);
+            ESP.restart();
+        } else {
+            Serial.println("[Dashboard] OTA end failed");
+            Update.printError(Serial);
+        }
+#endif
+        _otaInProgress = false;
+    }
+     
+    // Route a WebSocket data frame: whole messages are parsed in place, fragments are
+    // collected in the sending client's reassembly slot until the message is complete
+    void handleWebSocketFrame(AsyncWebSocketClient* client, AwsFrameInfo* info, uint8_t* data, size_t len) {
+        if (info->message_opcode != WS_TEXT) return;
+        
+        // Handle unfragmented frames directly
+        if (info->final && info->num == 0 && info->index == 0 && info->len == len) {
+            if (len > DASHBOARD_WS_MAX_MESSAGE_SIZE) {
+                Serial.printf("[Dashboard] Client #%u message too large (%u bytes), dropped\n",
+                              client->id(), (unsigned)len);
+                return;
+            }
+            handleWebSocketMessage(client, data, len, micros());
+            return;
+        }
+        
+        ReassemblySlot* slot = findReassemblySlot(client->id());
+        
+        // First fragment of a new message
+        if (info->num == 0 && info->index == 0) {
+            if (!slot) slot = acquireReassemblySlot(client->id());
+            if (!slot) {
+                Serial.printf("[Dashboard] Client #%u fragmented message dropped: no free slot\n", client->id());
+                return;
+            }
+            slot->filled = 0;
+            slot->discard = false;
+            slot->receivedUs = micros();
+            
+            // Reject early when the frame header already announces an oversized message
+            if (info->len > DASHBOARD_WS_MAX_MESSAGE_SIZE) {
+                Serial.printf("[Dashboard] Client #%u message too large (%u bytes), dropped\n",
+                              client->id(), (unsigned)info->len);
+                slot->discard = true;
+            }
+        }
+        if (!slot) return;  // Fragment of a message we never saw the start of
+        
+        if (!slot->discard) {
+            if (slot->filled + len > DASHBOARD_WS_MAX_MESSAGE_SIZE) {
+                Serial.printf("[Dashboard] Client #%u message exceeds %u bytes, dropped\n",
+                              client->id(), (unsigned)DASHBOARD_WS_MAX_MESSAGE_SIZE);
+                slot->discard = true;
+            } else {
+                memcpy(slot->buffer + slot->filled, data, len);
+                slot->filled += len;
+            }
+        }
+        
+        // Final fragment: parse the complete message
+        if (info->final && info->index + len >= info->len) {
+            if (!slot->discard) {
+                handleWebSocketMessage(client, slot->buffer, slot->filled, slot->receivedUs);
+            }
+            releaseReassemblySlot(client->id());
+        }
+    }
+    
+    ReassemblySlot* findReassemblySlot(uint32_t clientId) {
+        for (ReassemblySlot& slot : _wsSlots) {
+            if (slot.clientId == clientId) return &slot;
+        }
+        return nullptr;
+    }
+    
+    ReassemblySlot* acquireReassemblySlot(uint32_t clientId) {
+        ReassemblySlot* slot = findReassemblySlot(0);
+        if (!slot) return nullptr;
+        if (!slot->buffer) {
+            slot->buffer = new (std::nothrow) uint8_t[DASHBOARD_WS_MAX_MESSAGE_SIZE];
+            if (!slot->buffer) return nullptr;
+        }
+        slot->clientId = clientId;
+        return slot;
+    }
+    
+    void releaseReassemblySlot(uint32_t clientId) {
+        ReassemblySlot* slot = findReassemblySlot(clientId);
+        if (slot) {
+            slot->clientId = 0;
+            slot->filled = 0;
+            slot->discard = false;
+        }
+    }
+     
+    void sendCardsToClient(AsyncWebSocketClient* client) {
+        DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
+        DASHBOARD_METRIC(uint32_t metricStart = micros());
+        DynamicJsonDocument doc(8192);
+        doc["type"] = "init";
+        doc["title"] = _title;
+        if (_subtitle.length() > 0) {
+            doc["subtitle"] = _subtitle;
+        }
+        doc["enableOTA"] = _enableOTA;
+        doc["enableConsole"] = _enableConsole;
+        
+        // Include version info for OTA tab
+        if (_version.length() > 0) {
+            doc["version"] = _version;
+        }
+        if (_lastUpdate.length() > 0) {
+            doc["lastUpdate"] = _lastUpdate;
+        }
+        
+        JsonArray cardsArray = doc.createNestedArray("cards");
+        
+        for (auto& pair : _cards) {
+            JsonObject card = cardsArray.createNestedObject();
+            pair.second->toJson(card);
+        }
+        
+        // Include groups
+        if (_groups.size() > 0) {
+            JsonArray groupsArray = doc.createNestedArray("groups");
+            for (const CardGroup& group : _groups) {
+                JsonObject groupObj = groupsArray.createNestedObject();
+                groupObj["id"] = group.id;
+                groupObj["title"] = group.title;
+                JsonArray cardIdsArr = groupObj.createNestedArray("cardIds");
+                for (const String& cardId : group.cardIds) {
+                    cardIdsArr.add(cardId);
+                }
+            }
+        }
+        
+        DashboardFrame frame;
+        frame.encode(doc, isMsgpackClient(client->id()));
+        DASHBOARD_METRIC(_metrics.initSerialize.record(micros() - metricStart));
+        frame.send(client);
+        DASHBOARD_METRIC(_metrics.sent(MetricMessage::INIT, frame.length()));
+    }
+    
+    void sendHeartbeat() {
+        if (!_ws) return;
+        
+        // Send a minimal heartbeat message
         StaticJsonDocument<64> doc;
         doc["type"] = "heartbeat";
         doc["timestamp"] = millis();
         
-        String output;
-        serializeJson(doc, output);
-        _ws->textAll(output);
+        DashboardFrame frame;
+        frame.encode(doc, allClientsMsgpack());
+        frame.sendAll(_ws);
+        DASHBOARD_METRIC(_metrics.sent(MetricMessage::HEARTBEAT, frame.length(), _ws->count()));
+    }
+    
+    // Broadcasts go out as MessagePack only when every client negotiated it; otherwise
+    // as JSON text, which MessagePack clients read as well.
+    bool allClientsMsgpack() const {
+        uint8_t packed = _msgpackClientCount.load(std::memory_order_relaxed);
+        return packed > 0 && packed >= _ws->count();
+    }
+    
+    bool isMsgpackClient(uint32_t clientId) {
+        if (_msgpackClientCount.load(std::memory_order_relaxed) == 0) return false;
+        _logMutex.lock();
+        bool packed = isMsgpackClientLocked(clientId);
+        _logMutex.unlock();
+        return packed;
+    }
+    
+    // Caller holds _logMutex
+    bool isMsgpackClientLocked(uint32_t clientId) const {
+        return std::find(_msgpackClients.begin(), _msgpackClients.end(), clientId) != _msgpackClients.end();
+    }
+    
+    // Record the protocol a client asked for in its init message (false on disconnect)
+    void setClientProtocol(uint32_t clientId, bool msgpack) {
+        _logMutex.lock();
+        auto it = std::find(_msgpackClients.begin(), _msgpackClients.end(), clientId);
+        if (msgpack != (it != _msgpackClients.end())) {
+            // Pending lines were serialized for the old set of protocols
+            flushLogBatchLocked();
+            if (msgpack) {
+                _msgpackClients.push_back(clientId);
+            } else {
+                _msgpackClients.erase(it);
+            }
+            _msgpackClientCount.store((uint8_t)_msgpackClients.size(), std::memory_order_relaxed);
+        }
+        _logMutex.unlock();
     }
 
 public:
     ESPDashboardPlus(const String& title = "ESP32 Dashboard") 
         : _title(title), _server(nullptr), _ws(nullptr), 
           _otaInProgress(false), _otaSize(0), _otaReceived(0),
-          _htmlData(nullptr), _htmlSize(0), _lastHeartbeat(0),
+          _lastHeartbeat(0),
           _enableOTA(true), _enableConsole(true) {}
      
      ~ESPDashboardPlus() {
+#if defined(ARDUINO_ARCH_ESP32)
+         if (_taskHandle) {
+             vTaskDelete(_taskHandle);
+             _taskHandle = nullptr;
+         }
+         if (captureInstance() == this) {
+             esp_log_set_vprintf(_prevVprintf);
+             captureInstance() = nullptr;
+         }
+         delete _logStore;
+         _logStore = nullptr;
+#endif
+         if (_recorder) {
+             _recorder->stop();
+             delete _recorder;
+             _recorder = nullptr;
+         }
+         
          for (auto& pair : _cards) {
              delete pair.second;
          }
          _cards.clear();
          
-         if (_wsBuffer) {
-             delete[] _wsBuffer;
-             _wsBuffer = nullptr;
-             _wsBufferSize = 0;
-             _wsBufferFilled = 0;
+         for (ReassemblySlot& slot : _wsSlots) {
+             delete[] slot.buffer;
+             slot.buffer = nullptr;
          }
+         
+         delete _actionQueue;
+         _actionQueue = nullptr;
+         delete _updateQueue;
+         _updateQueue = nullptr;
+#if DASHBOARD_METRICS
+         delete _loopMonitor;
+         _loopMonitor = nullptr;
+#endif
+         delete[] _logBatch;
+         _logBatch = nullptr;
+         delete[] _logFrame;
+         _logFrame = nullptr;
+         delete _logCapture;
+         _logCapture = nullptr;
+         delete[] _assetETags;
+         _assetETags = nullptr;
      }
  
 // Backwards compatibility alias
@@ -1366,71 +3941,99 @@ using ESPDashboard = ESPDashboardPlus;
      */
     void begin(AsyncWebServer* server, const uint8_t* htmlData, size_t htmlSize, 
                bool enableOTA = true, bool enableConsole = true, const String& wsPath = "/ws") {
+        begin(server, htmlData, htmlSize, nullptr, 0, enableOTA, enableConsole, wsPath);
+    }
+    
+    /**
+     * Initialize dashboard with gzip and Brotli variants of the page
+     * Browsers that accept Brotli get brData, all others gzipData. Either
+     * may be nullptr when the header was generated with one encoding only;
+     * DASHBOARD_HTML_VARIANTS from dashboard_html.h fills in all four.
+     * 
+     *   dashboard.begin(&server, DASHBOARD_HTML_VARIANTS);
+     */
+    void begin(AsyncWebServer* server, const uint8_t* gzipData, size_t gzipSize,
+               const uint8_t* brData, size_t brSize,
+               bool enableOTA = true, bool enableConsole = true, const String& wsPath = "/ws") {
+        _page = DashboardAsset{"/", "text/html", "no-cache", gzipData, gzipSize, brData, brSize};
+        begin(server, &_page, 1, enableOTA, enableConsole, wsPath);
+    }
+    
+    /**
+     * Initialize dashboard with the asset table of the generated header
+     * Registers a handler per asset: the page shell at "/" and, for a split
+     * build (custom_dashboard_split), its content-hashed app.<hash>.js and
+     * app.<hash>.css, which browsers cache for good.
+     * 
+     *   dashboard.begin(&server, DASHBOARD_ASSETS, DASHBOARD_ASSET_COUNT);
+     */
+    void begin(AsyncWebServer* server, const DashboardAsset* assets, size_t assetCount,
+               bool enableOTA = true, bool enableConsole = true, const String& wsPath = "/ws") {
         _server = server;
         _ws = new AsyncWebSocket(wsPath);
-        _htmlData = htmlData;
-        _htmlSize = htmlSize;
+        _assets = assets;
+        _assetCount = assetCount;
+        delete[] _assetETags;
+        _assetETags = new AssetETags[assetCount];
+        for (size_t i = 0; i < assetCount; i++) {
+            formatETag(_assetETags[i].gzip, assets[i].gzipData, assets[i].gzipSize);
+            formatETag(_assetETags[i].br, assets[i].brData, assets[i].brSize);
+        }
         _enableOTA = enableOTA;
         _enableConsole = enableConsole;
+        if (!_updateQueue) {
+            _updateQueue = new UpdateQueue();
+        }
         
         // WebSocket event handler
         _ws->onEvent([this](AsyncWebSocket* server, AsyncWebSocketClient* client, 
                            AwsEventType type, void* arg, uint8_t* data, size_t len) {
             if (type == WS_EVT_CONNECT) {
                 Serial.printf("[Dashboard] Client #%u connected\n", client->id());
-                sendCardsToClient(client);
+                if (recording()) _recorder->entry(DashboardRecorder::CONNECT).varint(client->id());
+                subscribeLogs(client->id(), "debug", JsonArray());
+                if (_actionQueue) {
+                    deferInit(client->id());
+                } else {
+                    sendCardsToClient(client);
+                }
             } else if (type == WS_EVT_DISCONNECT) {
                 Serial.printf("[Dashboard] Client #%u disconnected\n", client->id());
+                if (recording()) _recorder->entry(DashboardRecorder::DISCONNECT).varint(client->id());
+                releaseReassemblySlot(client->id());
+                unsubscribeLogs(client->id());
+                setClientProtocol(client->id(), false);
             } else if (type == WS_EVT_DATA) {
-                AwsFrameInfo* info = (AwsFrameInfo*)arg;
-                if (info->opcode == WS_TEXT) {
-                    // Handle unfragmented frames directly
-                    if (info->final && info->index == 0 && info->len == len) {
-                        handleWebSocketMessage(client, data, len);
-                    } else {
-                        // Reassemble fragmented frames
-                        if (info->index == 0) {
-                            // First fragment: allocate buffer for the full message length
-                            if (_wsBuffer) {
-                                delete[] _wsBuffer;
-                                _wsBuffer = nullptr;
-                                _wsBufferSize = 0;
-                                _wsBufferFilled = 0;
-                            }
-                            _wsBufferSize = info->len;
-                            _wsBufferFilled = 0;
-                            _wsBuffer = new uint8_t[_wsBufferSize];
-                        }
-                        
-                        // Copy this fragment into the correct offset
-                        if (_wsBuffer && (info->index + len) <= _wsBufferSize) {
-                            memcpy(_wsBuffer + info->index, data, len);
-                            _wsBufferFilled += len;
-                        }
-                        
-                        // Final fragment: parse the complete message
-                        if (info->final && _wsBuffer && _wsBufferFilled == _wsBufferSize) {
-                            handleWebSocketMessage(client, _wsBuffer, _wsBufferSize);
-                            delete[] _wsBuffer;
-                            _wsBuffer = nullptr;
-                            _wsBufferSize = 0;
-                            _wsBufferFilled = 0;
-                        }
-                    }
-                }
+                handleWebSocketFrame(client, (AwsFrameInfo*)arg, data, len);
             }
         });
         
         _server->addHandler(_ws);
         
-        // Serve compressed dashboard HTML from PROGMEM
-        _server->on("/", HTTP_GET, [this](AsyncWebServerRequest* request) {
-            AsyncWebServerResponse* response = request->beginResponse_P(
-                200, "text/html", _htmlData, _htmlSize);
-            response->addHeader("Content-Encoding", "gzip");
-            response->addHeader("Cache-Control", "max-age=86400");
-            request->send(response);
-        });
+        // Serve the compressed UI from PROGMEM. Browsers keep the page but revalidate
+        // every load, so a firmware update with a new page is picked up at once and
+        // unchanged pages cost one 304. Hashed bundles are never asked for again.
+        for (size_t i = 0; i < assetCount; i++) {
+            _server->on(assets[i].path, HTTP_GET, [this, i](AsyncWebServerRequest* request) {
+#if defined(ARDUINO_ARCH_ESP32)
+                if (_uiFS && sendFile(request, _assets[i].path, _assets[i].contentType, _assets[i].cacheControl)) return;
+#endif
+                sendAsset(request, i);
+            });
+        }
+#if defined(ARDUINO_ARCH_ESP32)
+        // Bundles of a newer UI on the filesystem have hashes the firmware doesn't know
+        if (_uiFS) {
+            _server->on("/app.*", HTTP_GET, [this](AsyncWebServerRequest* request) {
+                const String& url = request->url();
+                const char* type = url.endsWith(".css") ? "text/css" : "application/javascript";
+                if (!isBundlePath(url.c_str()) ||
+                    !sendFile(request, url.c_str(), type, "public, max-age=31536000, immutable")) {
+                    request->send(404);
+                }
+            });
+        }
+#endif
         
         Serial.println("[Dashboard] Initialized with PROGMEM HTML");
         Serial.printf("[Dashboard] OTA: %s, Console: %s\n", 
@@ -1438,17 +4041,75 @@ using ESPDashboard = ESPDashboardPlus;
                       enableConsole ? "enabled" : "disabled");
     }
      
+#if defined(ARDUINO_ARCH_ESP32)
+    /**
+     * Initialize dashboard with the web UI on a filesystem (e.g. LittleFS)
+     * Files are looked up as <dir>/index.html for "/" and <dir>/<name> for the
+     * bundles, preferring <file>.br for browsers that accept Brotli, then
+     * <file>.gz, then the plain file. Anything missing there is served from the
+     * PROGMEM assets, so the firmware still works with an empty filesystem.
+     * Set custom_dashboard_fs_dir to have the build write the files; a UI change
+     * then only needs the filesystem image uploaded. Mount the filesystem first.
+     * 
+     *   LittleFS.begin(true);
+     *   dashboard.begin(&server, LittleFS, "/www", DASHBOARD_ASSETS, DASHBOARD_ASSET_COUNT);
+     */
+    void begin(AsyncWebServer* server, fs::FS& fs, const char* dir,
+               const DashboardAsset* assets, size_t assetCount,
+               bool enableOTA = true, bool enableConsole = true, const String& wsPath = "/ws") {
+        _uiFS = &fs;
+        _uiDir = dir;
+        if (_uiDir.endsWith("/")) _uiDir = _uiDir.substring(0, _uiDir.length() - 1);
+        begin(server, assets, assetCount, enableOTA, enableConsole, wsPath);
+        bool found = fs.exists(_uiDir + "/index.html.br") || fs.exists(_uiDir + "/index.html.gz") ||
+                     fs.exists(_uiDir + "/index.html");
+        Serial.printf("[Dashboard] UI files: %s%s\n", _uiDir.c_str(), found ? "" : " (no index.html, using PROGMEM)");
+    }
+#endif
+     
     void loop() {
-        if (_ws) {
-            _ws->cleanupClients();
-            
-            // Send heartbeat every 2.5 seconds
-            unsigned long now = millis();
-            if (now - _lastHeartbeat >= 2500) {
-                sendHeartbeat();
-                _lastHeartbeat = now;
-            }
+        // The dashboard task does this work when beginTask() was used
+        if (_taskRunning) return;
+        service(0);
+    }
+    
+    /**
+     * Run the dashboard housekeeping (client cleanup, heartbeats, published
+     * updates, deferred actions) in a library-owned FreeRTOS task instead of
+     * loop(). Call after begin(); loop() then becomes a no-op. Deferred
+     * callbacks and the command handler then run on this task, so state they
+     * share with loop() needs its own locking. The card calls (add, update,
+     * remove, groups) are serialized with the task; see lockCards() for
+     * changes made through card pointers.
+     * 
+     * @param core CPU core to pin the task to (default 0, away from the Arduino loop)
+     * @param priority FreeRTOS task priority
+     * @param periodMs Interval between iterations
+     * @param budgetUs Time allowed per iteration for draining queues (0 = unlimited)
+     * @return false if the task could not be created or the platform has no FreeRTOS
+     */
+    bool beginTask(int core = 0, int priority = 1, uint32_t periodMs = 10, uint32_t budgetUs = 4000) {
+#if defined(ARDUINO_ARCH_ESP32)
+        if (_taskRunning) return true;
+        _taskPeriodMs = periodMs;
+        _taskBudgetUs = budgetUs;
+        if (core < 0 || core >= portNUM_PROCESSORS) core = 0;
+        
+        _taskRunning = true;
+        if (xTaskCreatePinnedToCore(taskEntry, "dashboard", DASHBOARD_TASK_STACK_SIZE, this,
+                                    priority, &_taskHandle, core) != pdPASS) {
+            Serial.println("[Dashboard] Failed to create dashboard task");
+            _taskRunning = false;
+            _taskHandle = nullptr;
+            return false;
         }
+        Serial.printf("[Dashboard] Task started on core %d (priority %d, %u ms)\n",
+                      core, priority, (unsigned)periodMs);
+        return true;
+#else
+        Serial.println("[Dashboard] beginTask() not supported on this platform");
+        return false;
+#endif
     }
      
     void setTitle(const String& title) { _title = title; }
@@ -1471,6 +4132,36 @@ using ESPDashboard = ESPDashboardPlus;
         _onCommand = handler;
     }
     
+    /**
+     * Run card callbacks and the command handler from loop() instead of the
+     * network task. Inbound actions are queued by the WebSocket handler and
+     * dispatched on the next loop() call, so callbacks may touch cards and
+     * application state without locking. With beginTask() they are dispatched
+     * on the dashboard task instead: card calls stay safe, other state shared
+     * with loop() does not. OTA uploads are still handled directly. Call
+     * before begin(); later calls are ignored because the network task may
+     * already be queueing.
+     */
+    void setDeferredActions(bool enable) {
+        if (_ws) return;
+        if (enable && !_actionQueue) {
+            _actionQueue = new DeferredActionQueue();
+        } else if (!enable && _actionQueue) {
+            delete _actionQueue;
+            _actionQueue = nullptr;
+        }
+    }
+    
+    /**
+     * Answer actions that carry a trace id from the page with an "ack" holding the
+     * device's receive, parse-done and callback start/end times (micros()). The
+     * page logs the round trip split into network, parse, queue and callback time.
+     * Per-card latency histograms are kept either way (DASHBOARD_METRICS).
+     */
+    void setActionTracing(bool enable) {
+        _actionTracing = enable;
+    }
+    
     /**
      * Check if OTA is enabled
      */
@@ -1484,112 +4175,115 @@ using ESPDashboard = ESPDashboardPlus;
      // Broadcast update to all clients
      void broadcastUpdate(const String& cardId, JsonObject& data) {
          if (!_ws) return;
+         DASHBOARD_METRIC(uint32_t metricStart = micros());
          
          StaticJsonDocument<512> doc;
          doc["type"] = "update";
          doc["cardId"] = cardId;
          doc["data"] = data;
          
-         String output;
-         serializeJson(doc, output);
-         _ws->textAll(output);
+         DashboardFrame frame;
+         frame.encode(doc, allClientsMsgpack());
+         DASHBOARD_METRIC(_metrics.updateSerialize.record(micros() - metricStart));
+         frame.sendAll(_ws);
+         DASHBOARD_METRIC(_metrics.sent(MetricMessage::UPDATE, frame.length(), _ws->count()));
      }
      
      // Add cards
      StatCard* addStatCard(const String& id, const String& title, const String& value = "", const String& unit = "") {
          StatCard* card = new StatCard(id, title, value, unit);
-         _cards[id] = card;
+         putCard(id, card);
          return card;
      }
      
      StatusCard* addStatusCard(const String& id, const String& title, StatusIcon icon = StatusIcon::INFO) {
          StatusCard* card = new StatusCard(id, title, icon);
-         _cards[id] = card;
+         putCard(id, card);
          return card;
      }
      
      ChartCard* addChartCard(const String& id, const String& title, ChartType type = ChartType::LINE, int maxPoints = 20) {
          ChartCard* card = new ChartCard(id, title, type, maxPoints);
-         _cards[id] = card;
+         putCard(id, card);
          return card;
      }
      
      ButtonCardImpl* addButtonCard(const String& id, const String& title, const String& label, ButtonCallback cb) {
          ButtonCardImpl* card = new ButtonCardImpl(id, title, label, cb);
-         _cards[id] = card;
+         putCard(id, card);
          return card;
      }
      
      LinkCard* addLinkCard(const String& id, const String& title, const String& label, const String& url) {
          LinkCard* card = new LinkCard(id, title, label, url);
-         _cards[id] = card;
+         putCard(id, card);
          return card;
      }
      
      TimezoneCard* addTimezoneCard(const String& id, const String& title, const String& label = "Get Browser Timezone") {
          TimezoneCard* card = new TimezoneCard(id, title, label);
-         _cards[id] = card;
+         putCard(id, card);
          return card;
      }
      
      DateCard* addDateCard(const String& id, const String& title, bool includeTime = false) {
          DateCard* card = new DateCard(id, title, includeTime);
-         _cards[id] = card;
+         putCard(id, card);
          return card;
      }
      
      TimeCard* addTimeCard(const String& id, const String& title, bool includeSeconds = false) {
          TimeCard* card = new TimeCard(id, title, includeSeconds);
-         _cards[id] = card;
+         putCard(id, card);
          return card;
      }
      
      LocationCard* addLocationCard(const String& id, const String& title, const String& label = "Get Current Location") {
          LocationCard* card = new LocationCard(id, title, label);
-         _cards[id] = card;
+         putCard(id, card);
          return card;
      }
      
      ActionButton* addActionButton(const String& id, const String& title, const String& label,
                                    const String& confirmTitle, const String& confirmMsg, ButtonCallback cb) {
          ActionButton* card = new ActionButton(id, title, label, confirmTitle, confirmMsg, cb);
-         _cards[id] = card;
+         putCard(id, card);
          return card;
      }
      
      InputCard* addInputCard(const String& id, const String& title, const String& placeholder = "") {
          InputCard* card = new InputCard(id, title, placeholder);
-         _cards[id] = card;
+         putCard(id, card);
          return card;
      }
      
      ColorPickerCard* addColorPickerCard(const String& id, const String& title, const String& defaultColor = "#00D4AA") {
          ColorPickerCard* card = new ColorPickerCard(id, title, defaultColor);
-         _cards[id] = card;
+         putCard(id, card);
          return card;
      }
      
      DropdownCardImpl* addDropdownCard(const String& id, const String& title, const String& placeholder = "Select...") {
          DropdownCardImpl* card = new DropdownCardImpl(id, title, placeholder);
-         _cards[id] = card;
+         putCard(id, card);
          return card;
      }
      
      ToggleCard* addToggleCard(const String& id, const String& title, const String& label = "", bool defaultValue = false) {
          ToggleCard* card = new ToggleCard(id, title, label, defaultValue);
-         _cards[id] = card;
+         putCard(id, card);
          return card;
      }
      
      SliderCard* addSliderCard(const String& id, const String& title, int min = 0, int max = 100, int step = 1, const String& unit = "") {
          SliderCard* card = new SliderCard(id, title, min, max, step, unit);
-         _cards[id] = card;
+         putCard(id, card);
          return card;
      }
      
      GaugeCard* addGaugeCard(const String& id, const String& title, float min = 0, float max = 100, const String& unit = "%") {
          GaugeCard* card = new GaugeCard(id, title, min, max, unit);
-         _cards[id] = card;
+         putCard(id, card);
          return card;
      }
      
@@ -1605,6 +4299,7 @@ using ESPDashboard = ESPDashboardPlus;
       * Cards added to a group will be displayed together under the group title
       */
      void addGroup(const String& id, const String& title) {
+         DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
          _groups.push_back(CardGroup(id, title));
      }
      
@@ -1612,6 +4307,7 @@ using ESPDashboard = ESPDashboardPlus;
       * Add a card to an existing group
       */
      void addCardToGroup(const String& groupId, const String& cardId) {
+         DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
          for (auto& group : _groups) {
              if (group.id == groupId) {
                  group.cardIds.push_back(cardId);
@@ -1628,6 +4324,7 @@ using ESPDashboard = ESPDashboardPlus;
          for (const String& cardId : cardIds) {
              group.cardIds.push_back(cardId);
          }
+         DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
          _groups.push_back(group);
      }
      
@@ -1635,6 +4332,7 @@ using ESPDashboard = ESPDashboardPlus;
       * Remove a card from a group
       */
      void removeCardFromGroup(const String& groupId, const String& cardId) {
+         DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
          for (auto& group : _groups) {
              if (group.id == groupId) {
                  group.cardIds.erase(
@@ -1650,6 +4348,7 @@ using ESPDashboard = ESPDashboardPlus;
       * Remove an entire group (does not delete the cards)
       */
      void removeGroup(const String& id) {
+         DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
          _groups.erase(
              std::remove_if(_groups.begin(), _groups.end(), 
                            [&id](const CardGroup& g) { return g.id == id; }),
@@ -1657,8 +4356,17 @@ using ESPDashboard = ESPDashboardPlus;
          );
      }
 
+     /**
+      * Hold the card lock while changing cards through their pointers (for
+      * example chart->addSeries()) after beginTask(). The add, update and
+      * remove calls take it themselves.
+      */
+     void lockCards() { _cardMutex.lock(); }
+     void unlockCards() { _cardMutex.unlock(); }
+     
      // Get card by ID
      DashboardCard* getCard(const String& id) {
+         DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
          if (_cards.find(id) != _cards.end()) {
              return _cards[id];
          }
@@ -1667,8 +4375,15 @@ using ESPDashboard = ESPDashboardPlus;
      
      // Remove card
      void removeCard(const String& id) {
+         DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
          if (_cards.find(id) != _cards.end()) {
-             delete _cards[id];
+             DashboardCard* card = _cards[id];
+             _dirtyCards.erase(std::remove(_dirtyCards.begin(), _dirtyCards.end(), card), _dirtyCards.end());
+             if (card->dispatching > 0) {
+                 card->removed = true;
+             } else {
+                 delete card;
+             }
              _cards.erase(id);
              
              // Notify clients
@@ -1676,16 +4391,21 @@ using ESPDashboard = ESPDashboardPlus;
              doc["type"] = "remove";
              doc["cardId"] = id;
              
-             String output;
-             serializeJson(doc, output);
-             if (_ws) _ws->textAll(output);
+             if (_ws) {
+                 DashboardFrame frame;
+                 frame.encode(doc, allClientsMsgpack());
+                 frame.sendAll(_ws);
+                 DASHBOARD_METRIC(_metrics.sent(MetricMessage::REMOVE, frame.length(), _ws->count()));
+             }
          }
      }
      
      // Update helpers
      void updateStatCard(const String& id, const String& value) {
+         DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
          StatCard* card = static_cast<StatCard*>(getCard(id));
          if (card && card->type == CardType::STAT) {
+             if (recording()) _recorder->update(DashboardRecorder::Update::STAT, id).str(value);
              card->setValue(value);
              
              StaticJsonDocument<256> doc;
@@ -1696,8 +4416,13 @@ using ESPDashboard = ESPDashboardPlus;
      }
      
      void updateStatusCard(const String& id, StatusIcon icon, CardVariant variant, const String& label, const String& message) {
+         DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
          StatusCard* card = static_cast<StatusCard*>(getCard(id));
          if (card && card->type == CardType::STATUS) {
+             if (recording()) {
+                 _recorder->update(DashboardRecorder::Update::STATUS, id)
+                     .u8((uint8_t)icon).u8((uint8_t)variant).str(label).str(message);
+             }
              card->setStatus(icon, variant, label, message);
              
              StaticJsonDocument<512> doc;
@@ -1712,8 +4437,10 @@ using ESPDashboard = ESPDashboardPlus;
      
      // Legacy: update single-series chart
      void updateChartCard(const String& id, float value) {
+         DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
          ChartCard* card = static_cast<ChartCard*>(getCard(id));
          if (card && card->type == CardType::CHART) {
+             if (recording()) _recorder->update(DashboardRecorder::Update::CHART, id).f32(value);
              card->addDataPoint(value);
              
              DynamicJsonDocument doc(2048);
@@ -1728,8 +4455,10 @@ using ESPDashboard = ESPDashboardPlus;
      
      // Update multi-series chart with a data point for a specific series
      void updateChartCard(const String& id, int seriesIndex, float value) {
+         DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
          ChartCard* card = static_cast<ChartCard*>(getCard(id));
          if (card && card->type == CardType::CHART) {
+             if (recording()) _recorder->update(DashboardRecorder::Update::CHART_SERIES, id).varint(seriesIndex).f32(value);
              card->addDataPoint(seriesIndex, value);
              
              DynamicJsonDocument doc(4096);
@@ -1749,8 +4478,10 @@ using ESPDashboard = ESPDashboardPlus;
      }
      
      void updateGaugeCard(const String& id, float value) {
+         DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
          GaugeCard* card = static_cast<GaugeCard*>(getCard(id));
          if (card && card->type == CardType::GAUGE) {
+             if (recording()) _recorder->update(DashboardRecorder::Update::GAUGE, id).f32(value);
              card->setValue(value);
              
              StaticJsonDocument<256> doc;
@@ -1761,8 +4492,10 @@ using ESPDashboard = ESPDashboardPlus;
      }
      
      void updateToggleCard(const String& id, bool value) {
+         DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
          ToggleCard* card = static_cast<ToggleCard*>(getCard(id));
          if (card && card->type == CardType::TOGGLE) {
+             if (recording()) _recorder->update(DashboardRecorder::Update::TOGGLE, id).u8(value);
              card->setValue(value);
              
              StaticJsonDocument<256> doc;
@@ -1773,8 +4506,10 @@ using ESPDashboard = ESPDashboardPlus;
      }
      
      void updateSliderCard(const String& id, int value) {
+         DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
          SliderCard* card = static_cast<SliderCard*>(getCard(id));
          if (card && card->type == CardType::SLIDER) {
+             if (recording()) _recorder->update(DashboardRecorder::Update::SLIDER, id).i32(value);
              card->setValue(value);
              
              StaticJsonDocument<256> doc;
@@ -1785,8 +4520,10 @@ using ESPDashboard = ESPDashboardPlus;
      }
      
      void updateColorCard(const String& id, const String& color) {
+         DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
          ColorPickerCard* card = static_cast<ColorPickerCard*>(getCard(id));
          if (card && card->type == CardType::COLOR) {
+             if (recording()) _recorder->update(DashboardRecorder::Update::COLOR, id).str(color);
              card->setValue(color);
              
              StaticJsonDocument<256> doc;
@@ -1797,8 +4534,10 @@ using ESPDashboard = ESPDashboardPlus;
      }
      
      void updateDropdownCard(const String& id, const String& value) {
+         DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
          DropdownCardImpl* card = static_cast<DropdownCardImpl*>(getCard(id));
          if (card && card->type == CardType::DROPDOWN) {
+             if (recording()) _recorder->update(DashboardRecorder::Update::DROPDOWN, id).str(value);
              card->setValue(value);
              
              StaticJsonDocument<256> doc;
@@ -1809,8 +4548,10 @@ using ESPDashboard = ESPDashboardPlus;
      }
      
      void updateDateCard(const String& id, const String& value) {
+         DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
          DateCard* card = static_cast<DateCard*>(getCard(id));
          if (card && card->type == CardType::DATE) {
+             if (recording()) _recorder->update(DashboardRecorder::Update::DATE, id).str(value);
              card->setValue(value);
              
              StaticJsonDocument<256> doc;
@@ -1821,8 +4562,10 @@ using ESPDashboard = ESPDashboardPlus;
      }
      
      void updateTimeCard(const String& id, const String& value) {
+         DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
          TimeCard* card = static_cast<TimeCard*>(getCard(id));
          if (card && card->type == CardType::TIME) {
+             if (recording()) _recorder->update(DashboardRecorder::Update::TIME, id).str(value);
              card->setValue(value);
              
              StaticJsonDocument<256> doc;
@@ -1833,8 +4576,10 @@ using ESPDashboard = ESPDashboardPlus;
      }
      
      void updateLocationCard(const String& id, float latitude, float longitude) {
+         DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
          LocationCard* card = static_cast<LocationCard*>(getCard(id));
          if (card && card->type == CardType::LOCATION) {
+             if (recording()) _recorder->update(DashboardRecorder::Update::LOCATION, id).f32(latitude).f32(longitude);
              card->setLocation(latitude, longitude);
              
              StaticJsonDocument<256> doc;
@@ -1846,8 +4591,10 @@ using ESPDashboard = ESPDashboardPlus;
      }
      
      void updateLinkCard(const String& id, const String& url) {
+         DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
          LinkCard* card = static_cast<LinkCard*>(getCard(id));
          if (card && card->type == CardType::LINK) {
+             if (recording()) _recorder->update(DashboardRecorder::Update::LINK, id).str(url);
              card->setUrl(url);
              
              StaticJsonDocument<256> doc;
@@ -1857,6 +4604,206 @@ using ESPDashboard = ESPDashboardPlus;
          }
      }
      
+    // ========================================
+    // Thread-safe publishing
+    // Safe to call from any FreeRTOS task without locking. Values are queued
+    // and applied on the next loop(); several values for the same card are
+    // coalesced into one update message. Returns false if the queue is full.
+    // ========================================
+    
+    bool publishUpdate(StatCard* card, const char* value) {
+        UpdateRecord rec = {card, UpdateKind::STAT_TEXT, 0, {0}, {0}, 0};
+        if (value) strncpy(rec.text, value, sizeof(rec.text) - 1);
+        return queueUpdate(rec);
+    }
+    
+    // Formatted with `decimals` digits when applied, not in the calling task
+    bool publishUpdate(StatCard* card, float value, int decimals = 1) {
+        UpdateRecord rec = {card, UpdateKind::STAT_NUMBER, (int8_t)decimals, {0}, {0}, 0};
+        rec.value.f = value;
+        return queueUpdate(rec);
+    }
+    
+    bool publishUpdate(GaugeCard* card, float value) {
+        UpdateRecord rec = {card, UpdateKind::GAUGE, 0, {0}, {0}, 0};
+        rec.value.f = value;
+        return queueUpdate(rec);
+    }
+    
+    bool publishUpdate(ChartCard* card, float value) {
+        UpdateRecord rec = {card, UpdateKind::CHART, 0, {0}, {0}, 0};
+        rec.value.f = value;
+        return queueUpdate(rec);
+    }
+    
+    bool publishUpdate(ChartCard* card, int seriesIndex, float value) {
+        UpdateRecord rec = {card, UpdateKind::CHART_SERIES, (int8_t)seriesIndex, {0}, {0}, 0};
+        rec.value.f = value;
+        return queueUpdate(rec);
+    }
+    
+    bool publishUpdate(ToggleCard* card, bool value) {
+        UpdateRecord rec = {card, UpdateKind::TOGGLE, 0, {0}, {0}, 0};
+        rec.value.b = value;
+        return queueUpdate(rec);
+    }
+    
+    bool publishUpdate(SliderCard* card, int value) {
+        UpdateRecord rec = {card, UpdateKind::SLIDER, 0, {0}, {0}, 0};
+        rec.value.i = value;
+        return queueUpdate(rec);
+    }
+    
+    /**
+     * Number of published updates dropped because the queue was full
+     */
+    uint32_t getDroppedUpdates() const { return _droppedUpdates.load(std::memory_order_relaxed); }
+    
+#if DASHBOARD_METRICS
+    // ========================================
+    // Metrics
+    // Served at /metrics (Prometheus) and /metrics.json
+    // ========================================
+    
+    /**
+     * Serve the library metrics at GET /metrics (Prometheus text) and
+     * GET /metrics.json. begin() does not register them, so a sketch only
+     * exposes its internals when it asks to. Call after begin().
+     */
+    void enableMetricsEndpoints() {
+        if (_metricsEndpoints || !_server) return;
+        _metricsEndpoints = true;
+        registerMetricsHandler();
+        _server->on("/metrics.json", HTTP_GET, [this](AsyncWebServerRequest* request) {
+            AsyncResponseStream* response = request->beginResponseStream("application/json");
+            JsonDocument doc;
+            metricsToJson(doc.to<JsonObject>());
+            serializeJson(doc, *response);
+            request->send(response);
+        });
+    }
+    
+    const DashboardMetrics& getMetrics() const { return _metrics; }
+    
+    /**
+     * Add a status card that shows heap, message rates and handler latency,
+     * refreshed every 2 seconds
+     */
+    StatusCard* addDiagnosticsCard(const String& id = "diagnostics", const String& title = "Diagnostics") {
+        StatusCard* card = addStatusCard(id, title, StatusIcon::INFO);
+        _diagnosticsCardId = id;
+        return card;
+    }
+    
+    /**
+     * Measure the context that runs the dashboard (loop(), or the task started
+     * by beginTask()): the interval between passes, the time spent inside each
+     * and the resulting CPU share, plus the task's unused stack on ESP32.
+     * Summarized over DASHBOARD_LOOP_WINDOWS windows of windowMs each and
+     * exported on /metrics and /metrics.json.
+     */
+    void enableLoopMonitor(uint32_t windowMs = 1000) {
+        if (!_loopMonitor) _loopMonitor = new LoopMonitor(windowMs);
+    }
+    
+    const LoopMonitor* getLoopMonitor() const { return _loopMonitor; }
+    
+    /**
+     * Add a status card showing the loop monitor's summary, refreshed every
+     * 2 seconds. Enables the monitor if needed. The card turns to a warning
+     * when the dashboard takes 10% of the CPU or less than 1 KB stack is left.
+     */
+    StatusCard* addLoopMonitorCard(const String& id = "loop-timing", const String& title = "Loop Timing") {
+        enableLoopMonitor();
+        StatusCard* card = addStatusCard(id, title, StatusIcon::INFO);
+        _loopCardId = id;
+        return card;
+    }
+    
+    /**
+     * Write all library metrics in Prometheus text exposition format
+     */
+    void printMetrics(Print& out) {
+        DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
+        for (size_t part = 0; printMetricsPart(out, part); part++) {}
+        for (auto& kv : _cards) printActionLatency(out, kv.second);
+    }
+    
+    /**
+     * Fill obj with the same metrics as printMetrics(), histograms summarized
+     */
+    void metricsToJson(JsonObject obj) {
+        JsonObject sent = obj["sent"].to<JsonObject>();
+        JsonObject received = obj["received"].to<JsonObject>();
+        for (size_t k = 0; k < DashboardMetrics::KINDS; k++) {
+            const char* name = DashboardMetrics::messageName(k);
+            JsonObject s = sent[name].to<JsonObject>();
+            s["messages"] = _metrics.sentMessages(k);
+            s["bytes"] = _metrics.sentBytes(k);
+            JsonObject r = received[name].to<JsonObject>();
+            r["messages"] = _metrics.receivedMessages(k);
+            r["bytes"] = _metrics.receivedBytes(k);
+        }
+        
+        JsonObject latency = obj["latencyUs"].to<JsonObject>();
+        _metrics.initSerialize.toJson(latency["initSerialize"].to<JsonObject>());
+        _metrics.updateSerialize.toJson(latency["updateSerialize"].to<JsonObject>());
+        _metrics.messageHandling.toJson(latency["messageHandling"].to<JsonObject>());
+        
+        JsonObject actions = obj["actionLatencyUs"].to<JsonObject>();
+        _cardMutex.lock();
+        for (auto& kv : _cards) {
+            MetricHistogram* histogram = kv.second->actionLatency.load(std::memory_order_acquire);
+            if (histogram) histogram->toJson(actions[kv.first].to<JsonObject>());
+        }
+        _cardMutex.unlock();
+        
+        obj["updatesDropped"] = getDroppedUpdates();
+        obj["updatesCoalesced"] = _metrics.coalescedUpdates.load(std::memory_order_relaxed);
+        obj["logLinesDropped"] = getDroppedLogLines();
+        JsonObject ota = obj["ota"].to<JsonObject>();
+        ota["bytes"] = _metrics.otaBytes();
+        ota["bytesPerSecond"] = _metrics.otaBytesPerSecond();
+        
+        JsonArray clients = obj["clients"].to<JsonArray>();
+        if (_ws) {
+            for (AsyncWebSocketClient& client : _ws->getClients()) {
+                if (client.status() != WS_CONNECTED) continue;
+                JsonObject c = clients.add<JsonObject>();
+                c["id"] = client.id();
+                c["queue"] = client.queueLen();
+            }
+        }
+        
+        if (_loopMonitor) {
+            JsonObject loop = obj["loop"].to<JsonObject>();
+            loopStatsToJson(loop["intervalUs"].to<JsonObject>(), _loopMonitor->interval.stats());
+            loopStatsToJson(loop["busyUs"].to<JsonObject>(), _loopMonitor->busy.stats());
+            loop["cpuShare"] = _loopMonitor->cpuShare();
+            if (_loopMonitor->stackHighWater() > 0) loop["stackFree"] = _loopMonitor->stackHighWater();
+        }
+        
+        JsonObject heap = obj["heap"].to<JsonObject>();
+        heap["free"] = ESP.getFreeHeap();
+        heap["largestBlock"] = largestFreeBlock();
+        obj["uptimeMs"] = millis();
+    }
+#endif
+    
+    /**
+     * Add the values of numeric cards to GET /metrics in Prometheus text format:
+     * stat (when the value is a number), gauge, slider, toggle (0/1) and the latest
+     * point of each chart series. Metric names are prefix + "_" + card id, the card
+     * title becomes the HELP text and the card's group a group="..." label. Cards
+     * whose ids give the same name share it and carry a card="..." label.
+     * The response is streamed card by card. Call after begin().
+     */
+    void enableCardMetrics(const String& prefix = "dashboard_card") {
+        _cardMetricsPrefix = prefix;
+        _cardMetrics = true;
+        registerMetricsHandler();
+    }
+    
     // ========================================
     // Console Log Functions
     // Logs to Console tab if enableConsole = true
@@ -1866,73 +4813,775 @@ using ESPDashboard = ESPDashboardPlus;
      * Log a debug message to the Console tab (no card required)
      */
     void logDebug(const String& message) {
-        broadcastLog(LogLevel::DEBUG, message);
+        broadcastLog(LogLevel::DEBUG, message.c_str(), message.length());
     }
     
     /**
      * Log an info message to the Console tab (no card required)
      */
     void logInfo(const String& message) {
-        broadcastLog(LogLevel::INFO, message);
+        broadcastLog(LogLevel::INFO, message.c_str(), message.length());
     }
     
     /**
      * Log a warning message to the Console tab (no card required)
      */
     void logWarning(const String& message) {
-        broadcastLog(LogLevel::WARNING, message);
+        broadcastLog(LogLevel::WARNING, message.c_str(), message.length());
     }
     
     /**
      * Log an error message to the Console tab (no card required)
      */
     void logError(const String& message) {
-        broadcastLog(LogLevel::ERROR, message);
+        broadcastLog(LogLevel::ERROR, message.c_str(), message.length());
     }
     
     /**
      * Generic log function with level (no card required)
      */
     void log(LogLevel level, const String& message) {
-        broadcastLog(level, message);
+        broadcastLog(level, message.c_str(), message.length());
+    }
+    
+    /**
+     * Log with a tag (e.g. a component name). Clients can subscribe to a set of
+     * tags so that only those lines are sent to them.
+     */
+    void log(LogLevel level, const char* tag, const String& message) {
+        broadcastLog(level, message.c_str(), message.length(), tag);
+    }
+    
+    /**
+     * printf-style log to the Console tab. The level check happens before any
+     * formatting, so filtered-out lines cost only a comparison. Output longer
+     * than DASHBOARD_LOG_LINE_SIZE - 1 characters is truncated.
+     */
+    void logf(LogLevel level, const char* fmt, ...) __attribute__((format(printf, 3, 4))) {
+        if (!isLogEnabled(level)) return;
+        
+        char line[DASHBOARD_LOG_LINE_SIZE];
+        va_list args;
+        va_start(args, fmt);
+        int len = vsnprintf(line, sizeof(line), fmt, args);
+        va_end(args);
+        if (len < 0) return;
+        if ((size_t)len >= sizeof(line)) {
+            len = dashboardUtf8Whole(line, sizeof(line) - 1);
+            line[len] = '\0';
+        }
+        
+        broadcastLog(level, line, len);
+    }
+    
+    /**
+     * printf-style log with a tag, see log(level, tag, message)
+     */
+    void logTagf(LogLevel level, const char* tag, const char* fmt, ...) __attribute__((format(printf, 4, 5))) {
+        if (!isLogEnabled(level)) return;
+        
+        char line[DASHBOARD_LOG_LINE_SIZE];
+        va_list args;
+        va_start(args, fmt);
+        int len = vsnprintf(line, sizeof(line), fmt, args);
+        va_end(args);
+        if (len < 0) return;
+        if ((size_t)len >= sizeof(line)) {
+            len = dashboardUtf8Whole(line, sizeof(line) - 1);
+            line[len] = '\0';
+        }
+        
+        broadcastLog(level, line, len, tag);
+    }
+    
+    /**
+     * Minimum level sent to the Console tab (default: DEBUG, i.e. everything)
+     */
+    void setLogLevel(LogLevel level) { _minLogLevel = level; }
+    LogLevel getLogLevel() const { return _minLogLevel; }
+    
+    /**
+     * True if a message at this level would be sent to at least one connected
+     * client or written to the log store. Use it to skip building expensive log messages.
+     */
+    bool isLogEnabled(LogLevel level) const {
+        if (level < _minLogLevel) return false;
+#if defined(ARDUINO_ARCH_ESP32)
+        if (_logStore && level >= _logStore->minLevel()) return true;
+#endif
+        return isLogSubscribed(level);
+    }
+    
+    /**
+     * Log lines are collected into one {type:"logs"} frame that is sent when it
+     * reaches DASHBOARD_LOG_BATCH_SIZE bytes or is older than this interval
+     * (checked in loop()). 0 sends every line immediately. Default: 100 ms.
+     */
+    void setLogFlushInterval(uint32_t ms) { _logFlushIntervalMs = ms; }
+    
+    /**
+     * Send any pending log lines now
+     */
+    void flushLogs() {
+        _logMutex.lock();
+        flushLogBatchLocked();
+        _logMutex.unlock();
+    }
+    
+    /**
+     * Collect log lines written by other tasks into the Console tab. Captured lines
+     * go through a lock-free ring (DASHBOARD_LOG_CAPTURE_SIZE bytes) that loop() /
+     * the dashboard task drains into the log batches; producers never block, and
+     * lines are dropped when the ring is full. Call once in setup().
+     * 
+     * @param captureEspLogs On ESP32, also capture ESP_LOGx output (it is still
+     *                       printed to the UART). Arduino's log_x only goes
+     *                       through it when the core is built with USE_ESP_IDF_LOG.
+     */
+    bool enableLogCapture(bool captureEspLogs = true) {
+        if (!_logCapture) {
+            _logCapture = new (std::nothrow) LogCaptureRing();
+            if (!_logCapture) return false;
+        }
+#if defined(ARDUINO_ARCH_ESP32)
+        if (captureEspLogs && captureInstance() == nullptr) {
+            captureInstance() = this;
+            _prevVprintf = esp_log_set_vprintf(&captureVprintf);
+        }
+#else
+        (void)captureEspLogs;
+#endif
+        return true;
+    }
+    
+    /**
+     * Queue a log line from any task without blocking (needs enableLogCapture()).
+     * Returns false if the line was dropped.
+     */
+    bool captureLog(LogLevel level, const char* tag, const char* message, size_t len) {
+        return pushCapturedLog(level, tag, tag ? strlen(tag) : 0, message, len);
+    }
+    
+    /**
+     * Captured lines dropped because the capture ring was full
+     */
+    uint32_t getDroppedLogLines() const { return _droppedLogLines.load(std::memory_order_relaxed); }
+    
+#if defined(ARDUINO_ARCH_ESP32)
+    /**
+     * Keep console history on flash so it survives crashes and reboots, and serve
+     * it at GET /logs (see DashboardLogStore::handleRequest for the filters).
+     * Lines at or above minLevel are stored whether or not a browser is connected.
+     * Call after begin(), with the filesystem already mounted.
+     * 
+     * @param fs Filesystem, e.g. LittleFS
+     * @param maxBytes Approximate total size of the history
+     * @param minLevel Lowest level that is stored
+     * @param dir Directory for the segment files
+     */
+    bool enableLogStore(fs::FS& fs, size_t maxBytes = 64 * 1024, LogLevel minLevel = LogLevel::INFO,
+                        const char* dir = "/logs") {
+        if (_logStore || !_server) return false;
+        DashboardLogStore* store = new (std::nothrow) DashboardLogStore(fs, dir, maxBytes, minLevel);
+        if (!store || !store->begin()) {
+            delete store;
+            return false;
+        }
+        _logStore = store;
+        
+        _server->on("/logs", HTTP_GET, [this](AsyncWebServerRequest* request) {
+            _logStore->handleRequest(request);
+        });
+        return true;
+    }
+    
+    /**
+     * Write buffered history lines to flash now (e.g. before a deliberate restart)
+     */
+    void flushLogStore() {
+        if (_logStore) _logStore->flush();
+    }
+    
+    DashboardLogStore* getLogStore() { return _logStore; }
+#endif
+    
+    /**
+     * Record traffic for replay on the host (extras/native/replay.cpp): the
+     * current cards, client connects and disconnects, every inbound WebSocket
+     * message and every update*Card() / publishUpdate() call, with microsecond
+     * timestamps, as a compact binary log (see DashboardRecorder). Records are
+     * buffered in RAM and written to out from loop(). Call after the cards are
+     * set up; out must stay valid until stopRecording().
+     * 
+     * @param out Destination, e.g. a File opened for writing on LittleFS or SD
+     */
+    bool startRecording(Print& out) {
+        if (recording()) return false;
+        if (!_recorder) _recorder = new (std::nothrow) DashboardRecorder();
+        if (!_recorder || !_recorder->start(out)) return false;
+        
+        DashboardLock<DashboardRecursiveMutex> lock(_cardMutex);
+        for (auto& pair : _cards) {
+            JsonDocument doc;
+            JsonObject card = doc.to<JsonObject>();
+            pair.second->toJson(card);
+            String json;
+            serializeJson(doc, json);
+            
+            // Chart layout for the replayer; the init JSON has no point limit
+            uint32_t maxPoints = 0;
+            uint8_t chartType = 0;
+            if (pair.second->type == CardType::CHART) {
+                ChartCard* chart = static_cast<ChartCard*>(pair.second);
+                maxPoints = chart->maxDataPoints;
+                chartType = (uint8_t)chart->chartType;
+            }
+            uint8_t head[11];
+            size_t headLen = DashboardRecorder::putVarint(maxPoints, head, sizeof(head));
+            head[headLen++] = chartType;
+            headLen += DashboardRecorder::putVarint(json.length(), head + headLen, sizeof(head) - headLen);
+            _recorder->appendOrWrite(DashboardRecorder::CARD, head, headLen, (const uint8_t*)json.c_str(), json.length());
+        }
+        return true;
+    }
+    
+    /**
+     * Write the buffered records and stop recording. Close the file afterwards.
+     */
+    void stopRecording() {
+        if (_recorder) _recorder->stop();
     }
+    
+    bool isRecording() const { return recording(); }
+    
+    /**
+     * Records lost because the RAM buffer was full (raise DASHBOARD_RECORDER_BUFFER)
+     */
+    uint32_t getDroppedRecords() const { return _recorder ? _recorder->droppedRecords() : 0; }
      
 private:
     
-    // Broadcast log directly to Console tab (without a card)
-    void broadcastLog(LogLevel level, const String& message) {
-        if (!_ws || !_enableConsole) return;
+    bool recording() const { return _recorder && _recorder->active(); }
+    
+    // The browser's cached copy is this version (If-None-Match lists etag or is *)
+    static bool etagMatches(AsyncWebServerRequest* request, const char* etag) {
+        const AsyncWebHeader* header = request->getHeader("If-None-Match");
+        if (!header) return false;
+        const String& value = header->value();
+        return value == "*" || strstr(value.c_str(), etag) != nullptr;
+    }
+    
+    // Accept-Encoding lists coding without refusing it (q=0)
+    static bool acceptsEncoding(AsyncWebServerRequest* request, const char* coding) {
+        const AsyncWebHeader* header = request->getHeader("Accept-Encoding");
+        if (!header) return false;
+        const char* p = header->value().c_str();
+        size_t len = strlen(coding);
+        while (*p) {
+            while (*p == ' ' || *p == ',') p++;
+            const char* name = p;
+            while (*p && *p != ',' && *p != ';' && *p != ' ') p++;
+            bool match = (size_t)(p - name) == len && strncasecmp(name, coding, len) == 0;
+            float q = 1.0f;
+            while (*p && *p != ',') {
+                if ((p[0] == 'q' || p[0] == 'Q') && p[1] == '=') q = atof(p + 2);
+                p++;
+            }
+            if (match) return q > 0.0f;
+        }
+        return false;
+    }
+    
+    static void formatETag(char (&etag)[12], const uint8_t* data, size_t size) {
+        if (data) {
+            snprintf(etag, sizeof(etag), "\"%08lx\"", (unsigned long)dashboardHashBytes(data, size));
+        } else {
+            etag[0] = '\0';
+        }
+    }
+    
+    // Serve an asset in the best encoding the browser takes, or 304 Not Modified if it
+    // has that one. Browsers offer br over HTTPS only, so plain-HTTP visits get gzip;
+    // a br-only build sends br anyway.
+    void sendAsset(AsyncWebServerRequest* request, size_t index) {
+        const DashboardAsset& asset = _assets[index];
+        bool negotiated = asset.gzipData && asset.brData;
+        bool br = asset.brData && (!asset.gzipData || acceptsEncoding(request, "br"));
+        const char* etag = br ? _assetETags[index].br : _assetETags[index].gzip;
+        
+        AsyncWebServerResponse* response;
+        if (etagMatches(request, etag)) {
+            response = request->beginResponse(304);
+        } else {
+            response = request->beginResponse_P(200, asset.contentType,
+                                                br ? asset.brData : asset.gzipData,
+                                                br ? asset.brSize : asset.gzipSize);
+            response->addHeader("Content-Encoding", br ? "br" : "gzip");
+        }
+        response->addHeader("ETag", etag);
+        response->addHeader("Cache-Control", asset.cacheControl);
+        // The encoding was chosen from Accept-Encoding, so caches must key on it
+        if (negotiated) response->addHeader("Vary", "Accept-Encoding");
+        request->send(response);
+    }
+    
+#if defined(ARDUINO_ARCH_ESP32)
+    // "/app.<8 hex digits>.css" or ".js": the only names served from the UI directory
+    // besides "/". Rules out "/", ".." and anything else that could leave the directory.
+    static bool isBundlePath(const char* path) {
+        if (strncmp(path, "/app.", 5) != 0) return false;
+        const char* p = path + 5;
+        for (int i = 0; i < 8; i++, p++) {
+            if (!((*p >= '0' && *p <= '9') || (*p >= 'a' && *p <= 'f'))) return false;
+        }
+        return strcmp(p, ".css") == 0 || strcmp(p, ".js") == 0;
+    }
+    
+    // Serve path from the UI directory, streamed from flash in response-sized chunks.
+    // Returns false if the filesystem has no variant of the file.
+    bool sendFile(AsyncWebServerRequest* request, const char* path, const char* contentType,
+                  const char* cacheControl) {
+        if (strcmp(path, "/") != 0 && !isBundlePath(path)) return false;
+        String file = _uiDir + (strcmp(path, "/") == 0 ? "/index.html" : path);
+        const char* encoding = nullptr;
+        if (acceptsEncoding(request, "br") && _uiFS->exists(file + ".br")) {
+            file += ".br";
+            encoding = "br";
+        } else if (_uiFS->exists(file + ".gz")) {
+            file += ".gz";
+            encoding = "gzip";
+        } else if (!_uiFS->exists(file)) {
+            return false;
+        }
         
-        // Get timestamp
-        unsigned long ms = millis();
-        unsigned long secs = ms / 1000;
-        unsigned long mins = secs / 60;
-        unsigned long hours = mins / 60;
+        std::shared_ptr<File> f = std::make_shared<File>(_uiFS->open(file, "r"));
+        if (!*f || f->isDirectory()) return false;
+        char etag[12];
+        fileETag(file, *f, etag);
         
-        char timestamp[16];
-        snprintf(timestamp, sizeof(timestamp), "%02lu:%02lu:%02lu.%03lu", 
-                 hours % 24, mins % 60, secs % 60, ms % 1000);
+        AsyncWebServerResponse* response;
+        if (etagMatches(request, etag)) {
+            response = request->beginResponse(304);
+        } else {
+            response = request->beginResponse(contentType, f->size(),
+                [f](uint8_t* buffer, size_t maxLen, size_t) -> size_t {
+                    return f->read(buffer, maxLen);
+                });
+            if (encoding) response->addHeader("Content-Encoding", encoding);
+        }
+        response->addHeader("ETag", etag);
+        response->addHeader("Cache-Control", cacheControl);
+        if (encoding) response->addHeader("Vary", "Accept-Encoding");
+        request->send(response);
+        return true;
+    }
+    
+    // ETag of a UI file: the content hash the build wrote to <file>.etag, so a file
+    // replaced by one of the same size still gets a new tag. Files copied without
+    // one are hashed on every request.
+    void fileETag(const String& path, File& f, char (&etag)[12]) {
+        File tag = _uiFS->open(path + ".etag", "r");
+        if (tag) {
+            char hash[9] = {0};
+            size_t n = tag.read((uint8_t*)hash, 8);
+            tag.close();
+            if (n > 0) {
+                snprintf(etag, sizeof(etag), "\"%s\"", hash);
+                return;
+            }
+        }
         
-        // Convert level to string
-        String levelStr;
-        switch (level) {
-            case LogLevel::DEBUG: levelStr = "debug"; break;
-            case LogLevel::INFO: levelStr = "info"; break;
-            case LogLevel::WARNING: levelStr = "warning"; break;
-            case LogLevel::ERROR: levelStr = "error"; break;
-            default: levelStr = "info"; break;
+        uint32_t h = 2166136261u;
+        uint8_t buffer[256];
+        size_t n;
+        while ((n = f.read(buffer, sizeof(buffer))) > 0) h = dashboardHashBytes(buffer, n, h);
+        f.seek(0);
+        snprintf(etag, sizeof(etag), "\"%08lx\"", (unsigned long)h);
+    }
+#endif
+    
+    // Broadcast log directly to Console tab (without a card). The line is appended
+    // to the current batch; the batch is sent when full or by the flush interval.
+    void broadcastLog(LogLevel level, const char* message, size_t len, const char* tag = nullptr) {
+        if (level < _minLogLevel) return;
+        uint32_t now = millis();
+        
+#if defined(ARDUINO_ARCH_ESP32)
+        if (_logStore && level >= _logStore->minLevel()) {
+            _logStore->append(level, tag, message, len, now);
         }
+#endif
+        if (!isLogSubscribed(level)) return;
+        
+        char timestamp[16];
+        ConsoleCard::formatTimestamp(now, timestamp, sizeof(timestamp));
         
-        StaticJsonDocument<512> doc;
-        doc["type"] = "log";
+        JsonDocument doc;
         doc["timestamp"] = timestamp;
-        doc["level"] = levelStr;
+        doc["level"] = logLevelName(level);
         doc["message"] = message;
+        if (tag && *tag) doc["tag"] = tag;
+        uint32_t tagHash = (tag && *tag) ? dashboardHash(tag) : 0;
         
-        String output;
-        serializeJson(doc, output);
-        _ws->textAll(output);
+        _logMutex.lock();
+        if (!_logBatch) {
+            _logBatch = new (std::nothrow) char[DASHBOARD_LOG_BATCH_SIZE];
+            _logFrame = new (std::nothrow) char[DASHBOARD_LOG_BATCH_SIZE + LOG_FRAME_OVERHEAD];
+        }
+        if (_logBatch && _logFrame) {
+            if (_logBatchCount == 0) _logBatchFormats = logFormatsLocked();
+            size_t jsonLen = (_logBatchFormats & LOG_FORMAT_JSON) ? measureJson(doc) : 0;
+            size_t packLen = (_logBatchFormats & LOG_FORMAT_MSGPACK) ? measureMsgPack(doc) : 0;
+            size_t entryLen = jsonLen + packLen;
+            
+            // Make room: a full batch goes out before the new line is added
+            if (_logBatchLen + sizeof(LogRecord) + entryLen > DASHBOARD_LOG_BATCH_SIZE) {
+                flushLogBatchLocked();
+            }
+            if (sizeof(LogRecord) + entryLen < DASHBOARD_LOG_BATCH_SIZE) {
+                if (_logBatchCount == 0) _logBatchStart = millis();
+                LogRecord rec = { (uint8_t)level, tagHash, (uint16_t)jsonLen, (uint16_t)packLen };
+                memcpy(_logBatch + _logBatchLen, &rec, sizeof(rec));
+                _logBatchLen += sizeof(rec);
+                if (jsonLen) serializeJson(doc, _logBatch + _logBatchLen, DASHBOARD_LOG_BATCH_SIZE - _logBatchLen);
+                _logBatchLen += jsonLen;
+                if (packLen) serializeMsgPack(doc, _logBatch + _logBatchLen, packLen);
+                _logBatchLen += packLen;
+                _logBatchCount++;
+            } else {
+                // Single line too big for a batch: send it on its own, as JSON for everyone
+                String output;
+                doc["type"] = "log";
+                serializeJson(doc, output);
+                for (auto& kv : _logSubscriptions) {
+                    if (!logMatches(kv.second, (uint8_t)level, tagHash)) continue;
+                    AsyncWebSocketClient* client = _ws->client(kv.first);
+                    if (!client) continue;
+                    client->text(output);
+                    DASHBOARD_METRIC(_metrics.sent(MetricMessage::LOG, output.length()));
+                }
+            }
+        }
+        if (_logFlushIntervalMs == 0) {
+            flushLogBatchLocked();
+        }
+        _logMutex.unlock();
+    }
+    
+    bool pushCapturedLog(LogLevel level, const char* tag, size_t tagLen, const char* message, size_t len) {
+        LogCaptureRing* ring = _logCapture;
+        if (!ring || !isLogEnabled(level)) return false;
+        
+        if (tagLen > 31) tagLen = 31;
+        len = dashboardUtf8Cut(message, len, DASHBOARD_CAPTURE_LINE_SIZE);
+        size_t recordLen = 2 + tagLen + len;
+        uint8_t* p = ring->reserve(recordLen);
+        if (!p) {
+            _droppedLogLines.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        p[0] = (uint8_t)level;
+        p[1] = (uint8_t)tagLen;
+        memcpy(p + 2, tag, tagLen);
+        memcpy(p + 2 + tagLen, message, len);
+        ring->commit(p, recordLen);
+        return true;
+    }
+    
+    // Move captured lines into the log batch (dashboard context)
+    void drainCapturedLogs(uint32_t start, uint32_t budgetUs) {
+        const uint8_t* p;
+        size_t len;
+        while (!budgetExceeded(start, budgetUs) && _logCapture->front(p, len)) {
+            char tag[32];
+            char message[DASHBOARD_CAPTURE_LINE_SIZE + 1];
+            size_t tagLen = p[1];
+            size_t messageLen = len - 2 - tagLen;
+            memcpy(tag, p + 2, tagLen);
+            tag[tagLen] = '\0';
+            memcpy(message, p + 2 + tagLen, messageLen);
+            message[messageLen] = '\0';
+            LogLevel level = (LogLevel)p[0];
+            _logCapture->pop();
+            
+            broadcastLog(level, message, messageLen, tagLen ? tag : nullptr);
+        }
+    }
+    
+#if defined(ARDUINO_ARCH_ESP32)
+    // esp_log_set_vprintf() takes a plain function, so the hook finds the dashboard here
+    static ESPDashboardPlus*& captureInstance() {
+        static ESPDashboardPlus* instance = nullptr;
+        return instance;
+    }
+    
+    // ESP-IDF log hook. Lines look like "\033[0;33mW (1234) wifi: message\033[0m\n";
+    // the level letter is read from the format so unwanted lines are never formatted.
+    static int captureVprintf(const char* fmt, va_list args) {
+        ESPDashboardPlus* self = captureInstance();
+        if (self) {
+            const char* f = fmt;
+            if (*f == '\033') {
+                while (*f && *f != 'm') f++;
+                if (*f) f++;
+            }
+            LogLevel level;
+            switch (*f) {
+                case 'E': level = LogLevel::ERROR; break;
+                case 'W': level = LogLevel::WARNING; break;
+                case 'I': level = LogLevel::INFO; break;
+                default: level = LogLevel::DEBUG; break;
+            }
+            if (self->isLogEnabled(level)) {
+                char line[DASHBOARD_CAPTURE_LINE_SIZE];
+                va_list copy;
+                va_copy(copy, args);
+                int n = vsnprintf(line, sizeof(line), fmt, copy);
+                va_end(copy);
+                if (n > 0) {
+                    size_t len = (size_t)n < sizeof(line) ? (size_t)n : dashboardUtf8Whole(line, sizeof(line) - 1);
+                    self->captureEspLine(level, line, len);
+                }
+            }
+        }
+        vprintf_like_t prev = self ? self->_prevVprintf : nullptr;
+        return prev ? prev(fmt, args) : vprintf(fmt, args);
+    }
+    
+    // Split "W (1234) tag: message" into tag and message, dropping color codes and the newline
+    void captureEspLine(LogLevel level, const char* line, size_t len) {
+        const char* end = line + len;
+        while (end > line && (end[-1] == '\n' || end[-1] == '\r')) end--;
+        if (end - line >= 4 && memcmp(end - 4, "\033[0m", 4) == 0) end -= 4;
+        
+        const char* p = line;
+        if (*p == '\033') {
+            while (p < end && *p != 'm') p++;
+            if (p < end) p++;
+        }
+        const char* tag = nullptr;
+        size_t tagLen = 0;
+        const char* close = (const char*)memchr(p, ')', end - p);
+        if (close && close + 2 < end && close[1] == ' ') {
+            const char* colon = (const char*)memchr(close + 2, ':', end - close - 2);
+            if (colon) {
+                tag = close + 2;
+                tagLen = colon - tag;
+                p = colon + 1;
+                if (p < end && *p == ' ') p++;
+            }
+        }
+        pushCapturedLog(level, tag, tagLen, p, end - p);
+    }
+#endif
+    
+    // Some connected client wants lines at this level
+    bool isLogSubscribed(LogLevel level) const {
+        return _ws && _enableConsole && (uint8_t)level >= _logSubscriberLevel.load(std::memory_order_relaxed);
+    }
+    
+    static const char* logLevelName(LogLevel level) {
+        switch (level) {
+            case LogLevel::DEBUG: return "debug";
+            case LogLevel::WARNING: return "warning";
+            case LogLevel::ERROR: return "error";
+            default: return "info";
+        }
+    }
+    
+    static bool logMatches(const LogSubscription& sub, uint8_t level, uint32_t tagHash) {
+        if (level < (uint8_t)sub.minLevel) return false;
+        if (sub.tagCount == 0) return true;
+        for (uint8_t i = 0; i < sub.tagCount; i++) {
+            if (sub.tags[i] == tagHash) return true;
+        }
+        return false;
+    }
+    
+    static bool sameSubscription(const LogSubscription& a, const LogSubscription& b) {
+        return a.minLevel == b.minLevel && a.tagCount == b.tagCount &&
+               memcmp(a.tags, b.tags, a.tagCount * sizeof(uint32_t)) == 0;
+    }
+    
+    // Formats the next batch is serialized in: those of the subscribed clients.
+    // Caller holds _logMutex.
+    uint8_t logFormatsLocked() const {
+        size_t packed = 0;
+        for (auto& kv : _logSubscriptions) {
+            if (isMsgpackClientLocked(kv.first)) packed++;
+        }
+        return (packed < _logSubscriptions.size() ? LOG_FORMAT_JSON : 0) | (packed > 0 ? LOG_FORMAT_MSGPACK : 0);
+    }
+    
+    // Store a client's console filter; called on connect and on {type:"log_subscribe"}
+    void subscribeLogs(uint32_t clientId, const char* level, JsonArray tags) {
+        LogSubscription sub;
+        switch (dashboardHash(level)) {
+            case dashboardHash("info"): sub.minLevel = LogLevel::INFO; break;
+            case dashboardHash("warning"): sub.minLevel = LogLevel::WARNING; break;
+            case dashboardHash("error"): sub.minLevel = LogLevel::ERROR; break;
+            default: sub.minLevel = LogLevel::DEBUG; break;
+        }
+        for (JsonVariant tag : tags) {
+            const char* name = tag | "";
+            if (!*name || sub.tagCount >= DASHBOARD_LOG_MAX_TAGS) continue;
+            sub.tags[sub.tagCount++] = dashboardHash(name);
+        }
+        
+        _logMutex.lock();
+        // A new client may need a format the pending lines were not serialized in
+        if (_logSubscriptions.find(clientId) == _logSubscriptions.end()) flushLogBatchLocked();
+        _logSubscriptions[clientId] = sub;
+        updateLogSubscriberLevelLocked();
+        _logMutex.unlock();
+    }
+    
+    void unsubscribeLogs(uint32_t clientId) {
+        _logMutex.lock();
+        _logSubscriptions.erase(clientId);
+        updateLogSubscriberLevelLocked();
+        _logMutex.unlock();
+    }
+    
+    // Caller holds _logMutex
+    void updateLogSubscriberLevelLocked() {
+        uint8_t lowest = LOG_NO_SUBSCRIBERS;
+        for (auto& kv : _logSubscriptions) {
+            lowest = std::min(lowest, (uint8_t)kv.second.minLevel);
+        }
+        _logSubscriberLevel.store(lowest, std::memory_order_relaxed);
+    }
+    
+    // Build the {type:"logs"} frame of the batched lines matching sub into _logFrame,
+    // as JSON or MessagePack. Returns its length, or 0 if no line matches. Caller
+    // holds _logMutex.
+    size_t buildLogFrame(const LogSubscription& sub, bool msgpack) {
+        static const char prefix[] = "{\"type\":\"logs\",\"entries\":[";
+        // Map of 2: "type": "logs", "entries": array32 whose count is filled in below
+        static const uint8_t packPrefix[] = {
+            0x82, 0xA4, 't', 'y', 'p', 'e', 0xA4, 'l', 'o', 'g', 's',
+            0xA7, 'e', 'n', 't', 'r', 'i', 'e', 's', 0xDD, 0, 0, 0, 0
+        };
+        size_t frameLen = msgpack ? sizeof(packPrefix) : sizeof(prefix) - 1;
+        memcpy(_logFrame, msgpack ? (const void*)packPrefix : (const void*)prefix, frameLen);
+        
+        size_t matched = 0;
+        size_t pos = 0;
+        while (pos < _logBatchLen) {
+            LogRecord rec;
+            memcpy(&rec, _logBatch + pos, sizeof(rec));
+            pos += sizeof(rec);
+            if (logMatches(sub, rec.level, rec.tagHash)) {
+                if (msgpack) {
+                    memcpy(_logFrame + frameLen, _logBatch + pos + rec.jsonLen, rec.packLen);
+                    frameLen += rec.packLen;
+                    matched++;
+                } else {
+                    if (matched++ > 0) _logFrame[frameLen++] = ',';
+                    memcpy(_logFrame + frameLen, _logBatch + pos, rec.jsonLen);
+                    frameLen += rec.jsonLen;
+                }
+            }
+            pos += rec.jsonLen + rec.packLen;
+        }
+        if (matched == 0) return 0;
+        
+        if (msgpack) {
+            uint8_t* count = (uint8_t*)_logFrame + sizeof(packPrefix) - 4;
+            count[0] = (uint8_t)(matched >> 24);
+            count[1] = (uint8_t)(matched >> 16);
+            count[2] = (uint8_t)(matched >> 8);
+            count[3] = (uint8_t)matched;
+        } else {
+            _logFrame[frameLen++] = ']';
+            _logFrame[frameLen++] = '}';
+        }
+        return frameLen;
+    }
+    
+    // Send the batch to every client, filtered by its subscription. Clients with the
+    // same subscription share one built frame. Caller holds _logMutex.
+    void flushLogBatchLocked() {
+        if (_logBatchCount == 0) return;
+        
+        if (_ws) {
+            const LogSubscription* built = nullptr;
+            bool builtPacked = false;
+            size_t frameLen = 0;
+            for (auto& kv : _logSubscriptions) {
+                AsyncWebSocketClient* client = _ws->client(kv.first);
+                if (!client) continue;
+                // MessagePack clients also read JSON, so they get it if the batch has no MessagePack
+                bool packed = (_logBatchFormats & LOG_FORMAT_MSGPACK) && isMsgpackClientLocked(kv.first);
+                if (!packed && !(_logBatchFormats & LOG_FORMAT_JSON)) continue;
+                if (!built || packed != builtPacked || !sameSubscription(*built, kv.second)) {
+                    frameLen = buildLogFrame(kv.second, packed);
+                    built = &kv.second;
+                    builtPacked = packed;
+                }
+                if (frameLen == 0) continue;
+                if (packed) {
+                    client->binary((const uint8_t*)_logFrame, frameLen);
+                } else {
+                    client->text(_logFrame, frameLen);
+                }
+                DASHBOARD_METRIC(_metrics.sent(MetricMessage::LOG, frameLen));
+            }
+        }
+        _logBatchLen = 0;
+        _logBatchCount = 0;
+    }
+};
+
+/**
+ * Print that sends complete lines to the dashboard Console tab through the
+ * lock-free capture ring, optionally echoing everything to another Print:
+ * 
+ *   DashboardLogPrint logOut(dashboard, &Serial, LogLevel::INFO, "app");
+ *   logOut.printf("Boot took %lu ms\n", millis());
+ * 
+ * Needs dashboard.enableLogCapture(). The line buffer belongs to the instance,
+ * so use one instance per task.
+ */
+class DashboardLogPrint : public Print {
+public:
+    DashboardLogPrint(ESPDashboardPlus& dashboard, Print* echo = nullptr,
+                      LogLevel level = LogLevel::INFO, const char* tag = nullptr)
+        : _dashboard(dashboard), _echo(echo), _level(level), _tag(tag) {}
+    
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+    
+    size_t write(const uint8_t* buffer, size_t size) override {
+        if (_echo) _echo->write(buffer, size);
+        for (size_t i = 0; i < size; i++) {
+            char c = (char)buffer[i];
+            if (c == '\n') {
+                flushLine();
+            } else if (c != '\r' && _len < sizeof(_line)) {
+                _line[_len++] = c;
+            }
+        }
+        return size;
+    }
+    
+    void setLevel(LogLevel level) { _level = level; }
+    
+private:
+    void flushLine() {
+        // A full buffer means the line was cut, possibly inside a character
+        if (_len == sizeof(_line)) _len = dashboardUtf8Whole(_line, _len);
+        if (_len > 0) _dashboard.captureLog(_level, _tag, _line, _len);
+        _len = 0;
     }
+    
+    ESPDashboardPlus& _dashboard;
+    Print* _echo;
+    LogLevel _level;
+    const char* _tag;
+    char _line[DASHBOARD_CAPTURE_LINE_SIZE];
+    size_t _len = 0;
 };
 
 #endif // ESP_DASHBOARD_PLUS_H